@@ -37,6 +37,7 @@
 #include "gen_pfc.h"
 #include "gen_bpf.h"
 #include "helper.h"
+#include "oci.h"
 #include "system.h"
 
 #define API	__attribute__((visibility("default")))
@@ -331,7 +332,9 @@ API scmp_filter_ctx seccomp_init(uint32_t def_action)
 /* NOTE - function header comment in include/seccomp.h */
 API int seccomp_reset(scmp_filter_ctx ctx, uint32_t def_action)
 {
+	int rc;
 	struct db_filter_col *col = (struct db_filter_col *)ctx;
+	struct mem_acct *acct;
 
 	/* a NULL filter context indicates we are resetting the global state */
 	if (ctx == NULL) {
@@ -345,7 +348,10 @@ API int seccomp_reset(scmp_filter_ctx ctx, uint32_t def_action)
 		return _rc_filter(-EINVAL);
 
 	/* reset the filter */
-	return _rc_filter(db_col_reset(col, def_action));
+	acct = mem_acct_swap(&col->mem);
+	rc = db_col_reset(col, def_action);
+	mem_acct_swap(acct);
+	return _rc_filter(rc);
 }
 
 /* NOTE - function header comment in include/seccomp.h */
@@ -354,11 +360,28 @@ API void seccomp_release(scmp_filter_ctx ctx)
 	db_col_release((struct db_filter_col *)ctx);
 }
 
+/* NOTE - function header comment in include/seccomp.h */
+API int seccomp_set_allocator(scmp_filter_ctx ctx,
+			      const struct scmp_allocator *alloc)
+{
+	struct db_filter_col *col = (struct db_filter_col *)ctx;
+
+	/* a NULL filter context indicates the process-wide allocator */
+	if (ctx == NULL)
+		return _rc_filter(mem_acct_alloc_set(NULL, alloc));
+	if (_ctx_valid(ctx))
+		return _rc_filter(-EINVAL);
+
+	return _rc_filter(mem_acct_alloc_set(&col->mem, alloc));
+}
+
 /* NOTE - function header comment in include/seccomp.h */
 API int seccomp_merge(scmp_filter_ctx ctx_dst, scmp_filter_ctx ctx_src)
 {
+	int rc;
 	struct db_filter_col *col_dst = (struct db_filter_col *)ctx_dst;
 	struct db_filter_col *col_src = (struct db_filter_col *)ctx_src;
+	struct mem_acct *acct;
 
 	if (db_col_valid(col_dst) || db_col_valid(col_src))
 		return _rc_filter(-EINVAL);
@@ -369,7 +392,10 @@ API int seccomp_merge(scmp_filter_ctx ctx_dst, scmp_filter_ctx ctx_src)
 	    (col_dst->attr.tsync_enable != col_src->attr.tsync_enable))
 		return _rc_filter(-EINVAL);
 
-	return _rc_filter(db_col_merge(col_dst, col_src));
+	acct = mem_acct_swap(&col_dst->mem);
+	rc = db_col_merge(col_dst, col_src);
+	mem_acct_swap(acct);
+	return _rc_filter(rc);
 }
 
 /* NOTE - function header comment in include/seccomp.h */
@@ -410,8 +436,10 @@ API int seccomp_arch_exist(const scmp_filter_ctx ctx, uint32_t arch_token)
 /* NOTE - function header comment in include/seccomp.h */
 API int seccomp_arch_add(scmp_filter_ctx ctx, uint32_t arch_token)
 {
+	int rc;
 	const struct arch_def *arch;
 	struct db_filter_col *col = (struct db_filter_col *)ctx;
+	struct mem_acct *acct;
 
 	if (arch_token == 0)
 		arch_token = arch_def_native->token;
@@ -422,13 +450,18 @@ API int seccomp_arch_add(scmp_filter_ctx ctx, uint32_t arch_token)
 	if (db_col_arch_exist(col, arch_token))
 		return _rc_filter(-EEXIST);
 
-	return _rc_filter(db_col_db_new(col, arch));
+	acct = mem_acct_swap(&col->mem);
+	rc = db_col_db_new(col, arch);
+	mem_acct_swap(acct);
+	return _rc_filter(rc);
 }
 
 /* NOTE - function header comment in include/seccomp.h */
 API int seccomp_arch_remove(scmp_filter_ctx ctx, uint32_t arch_token)
 {
+	int rc;
 	struct db_filter_col *col = (struct db_filter_col *)ctx;
+	struct mem_acct *acct;
 
 	if (arch_token == 0)
 		arch_token = arch_def_native->token;
@@ -438,13 +471,18 @@ API int seccomp_arch_remove(scmp_filter_ctx ctx, uint32_t arch_token)
 	if (db_col_arch_exist(col, arch_token) != -EEXIST)
 		return _rc_filter(-EEXIST);
 
-	return _rc_filter(db_col_db_remove(col, arch_token));
+	acct = mem_acct_swap(&col->mem);
+	rc = db_col_db_remove(col, arch_token);
+	mem_acct_swap(acct);
+	return _rc_filter(rc);
 }
 
 /* NOTE - function header comment in include/seccomp.h */
 API int seccomp_load(const scmp_filter_ctx ctx)
 {
+	int rc;
 	struct db_filter_col *col;
+	struct mem_acct *acct;
 	bool rawrc;
 
 	if (_ctx_valid(ctx))
@@ -452,7 +490,10 @@ API int seccomp_load(const scmp_filter_ctx ctx)
 	col = (struct db_filter_col *)ctx;
 
 	rawrc = db_col_attr_read(col, SCMP_FLTATR_API_SYSRAWRC);
-	return _rc_filter(sys_filter_load(col, rawrc));
+	acct = mem_acct_swap(&col->mem);
+	rc = sys_filter_load(col, rawrc);
+	mem_acct_swap(acct);
+	return _rc_filter(rc);
 }
 
 /* NOTE - function header comment in include/seccomp.h */
@@ -470,11 +511,18 @@ API int seccomp_attr_get(const scmp_filter_ctx ctx,
 API int seccomp_attr_set(scmp_filter_ctx ctx,
 			 enum scmp_filter_attr attr, uint32_t value)
 {
+	int rc;
+	struct db_filter_col *col;
+	struct mem_acct *acct;
+
 	if (_ctx_valid(ctx))
 		return _rc_filter(-EINVAL);
+	col = (struct db_filter_col *)ctx;
 
-	return _rc_filter(db_col_attr_set((struct db_filter_col *)ctx,
-					  attr, value));
+	acct = mem_acct_swap(&col->mem);
+	rc = db_col_attr_set(col, attr, value);
+	mem_acct_swap(acct);
+	return _rc_filter(rc);
 }
 
 /* NOTE - function header comment in include/seccomp.h */
@@ -559,12 +607,34 @@ API int seccomp_syscall_resolve_name(const char *name)
 API int seccomp_syscall_priority(scmp_filter_ctx ctx,
 				 int syscall, uint8_t priority)
 {
+	int rc;
 	struct db_filter_col *col = (struct db_filter_col *)ctx;
+	struct mem_acct *acct;
 
 	if (db_col_valid(col) || _syscall_valid(col, syscall))
 		return _rc_filter(-EINVAL);
 
-	return _rc_filter(db_col_syscall_priority(col, syscall, priority));
+	acct = mem_acct_swap(&col->mem);
+	rc = db_col_syscall_priority(col, syscall, priority);
+	mem_acct_swap(acct);
+	return _rc_filter(rc);
+}
+
+/* NOTE - function header comment in include/seccomp.h */
+API int seccomp_syscall_weight(scmp_filter_ctx ctx,
+			       int syscall, uint32_t weight)
+{
+	int rc;
+	struct db_filter_col *col = (struct db_filter_col *)ctx;
+	struct mem_acct *acct;
+
+	if (db_col_valid(col) || _syscall_valid(col, syscall))
+		return _rc_filter(-EINVAL);
+
+	acct = mem_acct_swap(&col->mem);
+	rc = db_col_syscall_weight(col, syscall, weight);
+	mem_acct_swap(acct);
+	return _rc_filter(rc);
 }
 
 /* NOTE - function header comment in include/seccomp.h */
@@ -575,6 +645,7 @@ API int seccomp_rule_add_array(scmp_filter_ctx ctx,
 {
 	int rc;
 	struct db_filter_col *col = (struct db_filter_col *)ctx;
+	struct mem_acct *acct;
 
 	if (arg_cnt > ARG_COUNT_MAX)
 		return _rc_filter(-EINVAL);
@@ -590,8 +661,10 @@ API int seccomp_rule_add_array(scmp_filter_ctx ctx,
 	if (action == col->attr.act_default)
 		return _rc_filter(-EACCES);
 
-	return _rc_filter(db_col_rule_add(col, 0, action,
-					  syscall, arg_cnt, arg_array));
+	acct = mem_acct_swap(&col->mem);
+	rc = db_col_rule_add(col, 0, action, syscall, arg_cnt, arg_array);
+	mem_acct_swap(acct);
+	return _rc_filter(rc);
 }
 
 /* NOTE - function header comment in include/seccomp.h */
@@ -625,6 +698,7 @@ API int seccomp_rule_add_exact_array(scmp_filter_ctx ctx,
 {
 	int rc;
 	struct db_filter_col *col = (struct db_filter_col *)ctx;
+	struct mem_acct *acct;
 
 	if (arg_cnt > ARG_COUNT_MAX)
 		return _rc_filter(-EINVAL);
@@ -643,8 +717,10 @@ API int seccomp_rule_add_exact_array(scmp_filter_ctx ctx,
 	if (col->filter_cnt > 1)
 		return _rc_filter(-EOPNOTSUPP);
 
-	return _rc_filter(db_col_rule_add(col, 1, action,
-					  syscall, arg_cnt, arg_array));
+	acct = mem_acct_swap(&col->mem);
+	rc = db_col_rule_add(col, 1, action, syscall, arg_cnt, arg_array);
+	mem_acct_swap(acct);
+	return _rc_filter(rc);
 }
 
 /* NOTE - function header comment in include/seccomp.h */
@@ -671,6 +747,45 @@ API int seccomp_rule_add_exact(scmp_filter_ctx ctx,
 	return _rc_filter(rc);
 }
 
+/* NOTE - function header comment in include/seccomp.h */
+API int seccomp_rule_add_batch(scmp_filter_ctx ctx,
+			       const struct scmp_rule *rules,
+			       unsigned int rule_cnt)
+{
+	int rc;
+	unsigned int iter;
+	const struct scmp_rule *rule;
+	struct db_filter_col *col = (struct db_filter_col *)ctx;
+	struct mem_acct *acct;
+
+	if (db_col_valid(col))
+		return _rc_filter(-EINVAL);
+	if (rule_cnt > 0 && rules == NULL)
+		return _rc_filter(-EINVAL);
+
+	/* validate every rule before we touch the filter */
+	for (iter = 0; iter < rule_cnt; iter++) {
+		rule = &rules[iter];
+		if (rule->arg_cnt > ARG_COUNT_MAX)
+			return _rc_filter(-EINVAL);
+		if (rule->arg_cnt > 0 && rule->arg_array == NULL)
+			return _rc_filter(-EINVAL);
+		if (_syscall_valid(col, rule->syscall))
+			return _rc_filter(-EINVAL);
+
+		rc = db_col_action_valid(col, rule->action);
+		if (rc < 0)
+			return _rc_filter(rc);
+		if (rule->action == col->attr.act_default)
+			return _rc_filter(-EACCES);
+	}
+
+	acct = mem_acct_swap(&col->mem);
+	rc = db_col_rule_add_batch(col, rules, rule_cnt);
+	mem_acct_swap(acct);
+	return _rc_filter(rc);
+}
+
 /* NOTE - function header comment in include/seccomp.h */
 API int seccomp_notify_alloc(struct seccomp_notif **req,
 			     struct seccomp_notif_resp **resp)
@@ -733,27 +848,51 @@ API int seccomp_export_pfc(const scmp_filter_ctx ctx, int fd)
 {
 	int rc;
 	struct db_filter_col *col;
+	struct mem_acct *acct;
 
 	if (_ctx_valid(ctx))
 		return _rc_filter(-EINVAL);
 	col = (struct db_filter_col *)ctx;
 
+	acct = mem_acct_swap(&col->mem);
 	rc = gen_pfc_generate(col, fd);
+	mem_acct_swap(acct);
 	return _rc_filter_sys(col, rc);
 }
 
+/* NOTE - function header comment in include/seccomp.h */
+API int seccomp_export_pfc_mem(const scmp_filter_ctx ctx, char **buf,
+			       size_t *len)
+{
+	int rc;
+	struct db_filter_col *col;
+	struct mem_acct *acct;
+
+	if (_ctx_valid(ctx) || !buf || !len)
+		return _rc_filter(-EINVAL);
+	col = (struct db_filter_col *)ctx;
+
+	acct = mem_acct_swap(&col->mem);
+	rc = gen_pfc_generate_mem(col, buf, len);
+	mem_acct_swap(acct);
+	return _rc_filter(rc);
+}
+
 /* NOTE - function header comment in include/seccomp.h */
 API int seccomp_export_bpf(const scmp_filter_ctx ctx, int fd)
 {
 	int rc;
 	struct db_filter_col *col;
 	struct bpf_program *program;
+	struct mem_acct *acct;
 
 	if (_ctx_valid(ctx))
 		return _rc_filter(-EINVAL);
 	col = (struct db_filter_col *)ctx;
 
+	acct = mem_acct_swap(&col->mem);
 	rc = db_col_precompute(col);
+	mem_acct_swap(acct);
 	if (rc < 0)
 		return _rc_filter(rc);
 	program = col->prgm_bpf;
@@ -771,12 +910,15 @@ API int seccomp_export_bpf_mem(const scmp_filter_ctx ctx, void *buf,
 	int rc;
 	struct db_filter_col *col;
 	struct bpf_program *program;
+	struct mem_acct *acct;
 
 	if (_ctx_valid(ctx) || !len)
 		return _rc_filter(-EINVAL);
 	col = (struct db_filter_col *)ctx;
 
+	acct = mem_acct_swap(&col->mem);
 	rc = db_col_precompute(col);
+	mem_acct_swap(acct);
 	if (rc < 0)
 		return _rc_filter(rc);
 	program = col->prgm_bpf;
@@ -793,14 +935,85 @@ API int seccomp_export_bpf_mem(const scmp_filter_ctx ctx, void *buf,
 	return rc;
 }
 
+/* NOTE - function header comment in include/seccomp.h */
+API int seccomp_export_db(const scmp_filter_ctx ctx, void *buf, size_t *len)
+{
+	int rc;
+	struct db_filter_col *col;
+	struct mem_acct *acct;
+
+	if (_ctx_valid(ctx) || !len)
+		return _rc_filter(-EINVAL);
+	col = (struct db_filter_col *)ctx;
+
+	acct = mem_acct_swap(&col->mem);
+	rc = db_col_export(col, buf, len);
+	mem_acct_swap(acct);
+	return _rc_filter(rc);
+}
+
+/* NOTE - function header comment in include/seccomp.h */
+API int seccomp_import_db(scmp_filter_ctx ctx, const void *buf, size_t len)
+{
+	int rc;
+	struct db_filter_col *col = (struct db_filter_col *)ctx;
+	struct mem_acct *acct;
+
+	if (col == NULL || buf == NULL)
+		return _rc_filter(-EINVAL);
+
+	acct = mem_acct_swap(&col->mem);
+	rc = db_col_import(col, buf, len);
+	mem_acct_swap(acct);
+	return _rc_filter(rc);
+}
+
 /* NOTE - function header comment in include/seccomp.h */
 API int seccomp_precompute(const scmp_filter_ctx ctx)
 {
+	int rc;
 	struct db_filter_col *col;
+	struct mem_acct *acct;
 
 	if (_ctx_valid(ctx))
 		return _rc_filter(-EINVAL);
 	col = (struct db_filter_col *)ctx;
 
-	return _rc_filter(db_col_precompute(col));
+	acct = mem_acct_swap(&col->mem);
+	rc = db_col_precompute(col);
+	mem_acct_swap(acct);
+	return _rc_filter(rc);
+}
+
+/* NOTE - function header comment in include/seccomp.h */
+API int seccomp_import_oci(scmp_filter_ctx ctx, const char *buf, size_t len,
+			   uint64_t caps)
+{
+	int rc;
+	struct db_filter_col *col = (struct db_filter_col *)ctx;
+	struct mem_acct *acct;
+
+	if (db_col_valid(col) || buf == NULL)
+		return _rc_filter(-EINVAL);
+
+	acct = mem_acct_swap(&col->mem);
+	rc = oci_import(col, buf, len, caps);
+	mem_acct_swap(acct);
+	return _rc_filter(rc);
+}
+
+/* NOTE - function header comment in include/seccomp.h */
+API int seccomp_import_oci_fd(scmp_filter_ctx ctx, int fd, uint64_t caps)
+{
+	int rc;
+	struct db_filter_col *col = (struct db_filter_col *)ctx;
+	struct mem_acct *acct;
+
+	if (db_col_valid(col) || fd < 0)
+		return _rc_filter(-EINVAL);
+
+	acct = mem_acct_swap(&col->mem);
+	rc = oci_import_fd(col, fd, caps);
+	mem_acct_swap(acct);
+	return _rc_filter(rc);
 }
@@ -51,6 +51,8 @@ const struct arch_def arch_def_m68k = {
 	.syscall_resolve_name_raw = m68k_syscall_resolve_name,
 	.syscall_resolve_num = abi_syscall_resolve_num_munge,
 	.syscall_resolve_num_raw = m68k_syscall_resolve_num,
+	.syscall_mux_raw = m68k_syscall_mux,
+	.syscall_demux_raw = m68k_syscall_demux,
 	.syscall_rewrite = abi_syscall_rewrite,
 	.rule_add = abi_rule_add,
 	.syscall_name_kver = m68k_syscall_name_kver,
@@ -75,6 +75,42 @@ const char *mips_syscall_resolve_num_raw(int num)
 	return mips_syscall_resolve_num(num);
 }
 
+/**
+ * Convert a direct syscall into a multiplexed pseudo syscall
+ * @param num the syscall number
+ *
+ * Return the related multiplexed pseudo syscall number on success,
+ * __NR_SCMP_ERROR otherwise.
+ *
+ */
+int mips_syscall_mux_raw(int num)
+{
+	if (num >= __SCMP_NR_BASE)
+		num -= __SCMP_NR_BASE;
+	return mips_syscall_mux(num);
+}
+
+/**
+ * Convert a multiplexed pseudo syscall into a direct syscall
+ * @param num the multiplexed pseudo syscall number
+ *
+ * Return the related direct syscall number on success, including negative
+ * pseudo syscall numbers, __NR_SCMP_UNDEF if there is no related syscall, or
+ * __NR_SCMP_ERROR otherwise.
+ *
+ */
+int mips_syscall_demux_raw(int num)
+{
+	int sys;
+
+	/* NOTE: we don't want to modify the pseudo-syscall numbers */
+	sys = mips_syscall_demux(num);
+	if (sys < 0)
+		return sys;
+
+	return sys + __SCMP_NR_BASE;
+}
+
 ARCH_DEF(mips)
 
 const struct arch_def arch_def_mips = {
@@ -88,6 +124,8 @@ const struct arch_def arch_def_mips = {
 	.syscall_resolve_name_raw = mips_syscall_resolve_name_raw,
 	.syscall_resolve_num = abi_syscall_resolve_num_munge,
 	.syscall_resolve_num_raw = mips_syscall_resolve_num_raw,
+	.syscall_mux_raw = mips_syscall_mux_raw,
+	.syscall_demux_raw = mips_syscall_demux_raw,
 	.syscall_rewrite = abi_syscall_rewrite,
 	.rule_add = abi_rule_add,
 	.syscall_name_kver = mips_syscall_name_kver,
@@ -105,6 +143,8 @@ const struct arch_def arch_def_mipsel = {
 	.syscall_resolve_name_raw = mips_syscall_resolve_name_raw,
 	.syscall_resolve_num = abi_syscall_resolve_num_munge,
 	.syscall_resolve_num_raw = mips_syscall_resolve_num_raw,
+	.syscall_mux_raw = mips_syscall_mux_raw,
+	.syscall_demux_raw = mips_syscall_demux_raw,
 	.syscall_rewrite = abi_syscall_rewrite,
 	.rule_add = abi_rule_add,
 	.syscall_name_kver = mips_syscall_name_kver,
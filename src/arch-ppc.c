@@ -47,6 +47,8 @@ const struct arch_def arch_def_ppc = {
 	.syscall_resolve_name_raw = ppc_syscall_resolve_name,
 	.syscall_resolve_num = abi_syscall_resolve_num_munge,
 	.syscall_resolve_num_raw = ppc_syscall_resolve_num,
+	.syscall_mux_raw = ppc_syscall_mux,
+	.syscall_demux_raw = ppc_syscall_demux,
 	.syscall_rewrite = abi_syscall_rewrite,
 	.rule_add = abi_rule_add,
 	.syscall_name_kver = ppc_syscall_name_kver,
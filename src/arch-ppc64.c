@@ -47,6 +47,8 @@ const struct arch_def arch_def_ppc64 = {
 	.syscall_resolve_name_raw = ppc64_syscall_resolve_name,
 	.syscall_resolve_num = abi_syscall_resolve_num_munge,
 	.syscall_resolve_num_raw = ppc64_syscall_resolve_num,
+	.syscall_mux_raw = ppc64_syscall_mux,
+	.syscall_demux_raw = ppc64_syscall_demux,
 	.syscall_rewrite = abi_syscall_rewrite,
 	.rule_add = abi_rule_add,
 	.syscall_name_kver = ppc64_syscall_name_kver,
@@ -64,6 +66,8 @@ const struct arch_def arch_def_ppc64le = {
 	.syscall_resolve_name_raw = ppc64_syscall_resolve_name,
 	.syscall_resolve_num = abi_syscall_resolve_num_munge,
 	.syscall_resolve_num_raw = ppc64_syscall_resolve_num,
+	.syscall_mux_raw = ppc64_syscall_mux,
+	.syscall_demux_raw = ppc64_syscall_demux,
 	.syscall_rewrite = abi_syscall_rewrite,
 	.rule_add = abi_rule_add,
 	.syscall_name_kver = ppc64_syscall_name_kver,
@@ -39,6 +39,8 @@ const struct arch_def arch_def_sheb = {
 	.syscall_resolve_name_raw = sh_syscall_resolve_name,
 	.syscall_resolve_num = abi_syscall_resolve_num_munge,
 	.syscall_resolve_num_raw = sh_syscall_resolve_num,
+	.syscall_mux_raw = sh_syscall_mux,
+	.syscall_demux_raw = sh_syscall_demux,
 	.syscall_rewrite = abi_syscall_rewrite,
 	.rule_add = abi_rule_add,
 	.syscall_name_kver = sh_syscall_name_kver,
@@ -56,6 +58,8 @@ const struct arch_def arch_def_sh = {
 	.syscall_resolve_name_raw = sh_syscall_resolve_name,
 	.syscall_resolve_num = abi_syscall_resolve_num_munge,
 	.syscall_resolve_num_raw = sh_syscall_resolve_num,
+	.syscall_mux_raw = sh_syscall_mux,
+	.syscall_demux_raw = sh_syscall_demux,
 	.syscall_rewrite = abi_syscall_rewrite,
 	.rule_add = abi_rule_add,
 	.syscall_name_kver = sh_syscall_name_kver,
@@ -46,6 +46,8 @@ const struct arch_def arch_def_x86 = {
 	.syscall_resolve_name_raw = x86_syscall_resolve_name,
 	.syscall_resolve_num = abi_syscall_resolve_num_munge,
 	.syscall_resolve_num_raw = x86_syscall_resolve_num,
+	.syscall_mux_raw = x86_syscall_mux,
+	.syscall_demux_raw = x86_syscall_demux,
 	.syscall_rewrite = abi_syscall_rewrite,
 	.rule_add = abi_rule_add,
 	.syscall_name_kver = x86_syscall_name_kver,
@@ -424,40 +424,34 @@ int arch_syscall_rewrite(const struct arch_def *arch, int *syscall)
 }
 
 /**
- * Add a new rule to the specified filter
+ * Add a new rule to the specified filter using a translated syscall
  * @param db the seccomp filter db
- * @param strict the rule
+ * @param rule the rule
+ * @param syscall the rule's syscall, already translated for the filter
  *
- * This function adds a new argument/comparison/value to the seccomp filter for
- * a syscall; multiple arguments can be specified and they will be chained
- * together (essentially AND'd together) in the filter.  When the strict flag
- * is true the function will fail if the exact rule can not be added to the
- * filter, if the strict flag is false the function will not fail if the
- * function needs to adjust the rule due to architecture specifics.  Returns
- * zero on success, negative values on failure.
+ * This function is the same as arch_filter_rule_add() except that the caller
+ * has already translated the rule's syscall with arch_syscall_translate(),
+ * this allows callers which need the translated syscall for other purposes to
+ * avoid a second translation.  Returns zero on success, negative values on
+ * failure.
  *
  * It is important to note that in the case of failure the db may be corrupted,
  * the caller must use the transaction mechanism if the db integrity is
  * important.
  *
  */
-int arch_filter_rule_add(struct db_filter *db,
-			 const struct db_api_rule_list *rule)
+int arch_filter_rule_add_translated(struct db_filter *db,
+				    const struct db_api_rule_list *rule,
+				    int syscall)
 {
 	int rc = 0;
-	int syscall;
 	struct db_api_rule_list *rule_dup = NULL;
 
 	/* create our own rule that we can munge */
 	rule_dup = db_rule_dup(rule);
 	if (rule_dup == NULL)
 		return -ENOMEM;
-
-	/* translate the syscall */
-	rc = arch_syscall_translate(db->arch, &rule_dup->syscall);
-	if (rc < 0)
-		goto rule_add_return;
-	syscall = rule_dup->syscall;
+	rule_dup->syscall = syscall;
 
 	/* add the new rule to the existing filter */
 	if (syscall == -1 || db->arch->rule_add == NULL) {
@@ -474,6 +468,38 @@ rule_add_return:
 	/* NOTE: another reminder that we don't do any db error recovery here,
 	 * use the transaction mechanism as previously mentioned */
 	if (rule_dup != NULL)
-		free(rule_dup);
+		zfree(rule_dup);
 	return rc;
 }
+
+/**
+ * Add a new rule to the specified filter
+ * @param db the seccomp filter db
+ * @param strict the rule
+ *
+ * This function adds a new argument/comparison/value to the seccomp filter for
+ * a syscall; multiple arguments can be specified and they will be chained
+ * together (essentially AND'd together) in the filter.  When the strict flag
+ * is true the function will fail if the exact rule can not be added to the
+ * filter, if the strict flag is false the function will not fail if the
+ * function needs to adjust the rule due to architecture specifics.  Returns
+ * zero on success, negative values on failure.
+ *
+ * It is important to note that in the case of failure the db may be corrupted,
+ * the caller must use the transaction mechanism if the db integrity is
+ * important.
+ *
+ */
+int arch_filter_rule_add(struct db_filter *db,
+			 const struct db_api_rule_list *rule)
+{
+	int rc;
+	int syscall = rule->syscall;
+
+	/* translate the syscall */
+	rc = arch_syscall_translate(db->arch, &syscall);
+	if (rc < 0)
+		return rc;
+
+	return arch_filter_rule_add_translated(db, rule, syscall);
+}
@@ -62,6 +62,8 @@ struct arch_def {
 	const char *(*syscall_resolve_num)(const struct arch_def *arch,
 					   int num);
 	const char *(*syscall_resolve_num_raw)(int num);
+	int (*syscall_mux_raw)(int num);
+	int (*syscall_demux_raw)(int num);
 	int (*syscall_rewrite)(const struct arch_def *arch, int *syscall);
 	int (*rule_add)(struct db_filter *db, struct db_api_rule_list *rule);
 	enum scmp_kver (*syscall_name_kver)(const char *name);
@@ -76,6 +78,8 @@ extern const struct arch_def *arch_def_native;
 	extern const struct arch_def arch_def_##NAME; \
 	int NAME##_syscall_resolve_name(const char *name); \
 	const char *NAME##_syscall_resolve_num(int num); \
+	int NAME##_syscall_mux(int num); \
+	int NAME##_syscall_demux(int num); \
 	enum scmp_kver NAME##_syscall_name_kver(const char *name); \
 	enum scmp_kver NAME##_syscall_num_kver(int num); \
 	const struct arch_syscall_def *NAME##_syscall_iterate(unsigned int spot);
@@ -90,6 +94,14 @@ extern const struct arch_def *arch_def_native;
 	{ \
 		return syscall_resolve_num(num, SYSTBL_OFFSET(NAME)); \
 	} \
+	int NAME##_syscall_mux(int num) \
+	{ \
+		return syscall_resolve_num_mux(num, SYSTBL_OFFSET(NAME)); \
+	} \
+	int NAME##_syscall_demux(int num) \
+	{ \
+		return syscall_resolve_mux_num(num, SYSTBL_OFFSET(NAME)); \
+	} \
 	enum scmp_kver NAME##_syscall_name_kver(const char *name) \
 	{ \
 		return syscall_resolve_name_kver(name, \
@@ -135,5 +147,8 @@ int arch_syscall_rewrite(const struct arch_def *arch, int *syscall);
 
 int arch_filter_rule_add(struct db_filter *db,
 			 const struct db_api_rule_list *rule);
+int arch_filter_rule_add_translated(struct db_filter *db,
+				    const struct db_api_rule_list *rule,
+				    int syscall);
 
 #endif
@@ -32,8 +32,10 @@
 
 #include "arch.h"
 #include "db.h"
+#include "hash.h"
 #include "system.h"
 #include "helper.h"
+#include "trace.h"
 
 /* state values */
 #define _DB_STA_VALID			0xA1B2C3D4
@@ -46,6 +48,9 @@
 #define _DB_PRI_MASK_USER		0x00FF0000
 #define _DB_PRI_USER(x)			(((x) << 16) & _DB_PRI_MASK_USER)
 
+/* syscall weight used when the user has not provided one */
+#define _DB_WEIGHT_DEFAULT		1
+
 /* prove information about the sub-tree check results */
 struct db_iter_state {
 #define _DB_IST_NONE			0x00000000
@@ -64,7 +69,159 @@ struct db_iter_state {
 	struct db_sys_list *sx;
 };
 
+/* rule insertion order for a batch of rules */
+struct db_batch_ent {
+	int syscall;
+	unsigned int idx;
+};
+
+/* shared program cache, see db_col_precompute() */
+#define _DB_PRGM_CACHE_SLOTS		64
+#define _DB_PRGM_CACHE_IDLE_MAX		16
+
+struct db_prgm_cache {
+	/* canonical filter fingerprint */
+	uint32_t hash;
+	void *key;
+	size_t key_len;
+
+	/* the shared program */
+	struct bpf_program *prgm;
+	struct db_filter_stats stats;
+
+	unsigned int refcnt;
+	uint64_t stamp;
+	struct db_prgm_cache *next;
+};
+
+/* filter DB image, see db_col_export() */
+#define _DB_IMG_MAGIC			0x42444353
+#define _DB_IMG_VERSION			2
+#define _DB_IMG_NONE			((uint32_t)-1)
+#define _DB_IMG_F_NOTIFY		0x00000001
+#define _DB_IMG_DEPTH_MAX		(ARG_COUNT_MAX * 3)
+#define _DB_IMG_ST_SEEN			0x01
+#define _DB_IMG_ST_BUSY			0x02
+#define _DB_IMG_ST_DONE			0x04
+
+struct db_img_hdr {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t size;
+	uint32_t flags;
+	uint32_t attr_cnt;
+	uint32_t filter_cnt;
+};
+
+struct db_img_attr {
+	uint32_t attr;
+	uint32_t value;
+};
+
+struct db_img_filter {
+	uint32_t arch;
+	uint32_t syscall_cnt;
+	uint32_t sys_cnt;
+	uint32_t node_cnt;
+	uint32_t rule_cnt;
+	uint32_t pad;
+};
+
+struct db_img_sys {
+	uint32_t num;
+	uint32_t priority;
+	uint32_t action;
+	uint32_t node_cnt;
+	uint32_t chains;
+	uint32_t valid;
+	uint32_t weight;
+	uint32_t pad;
+};
+
+struct db_img_node {
+	uint64_t datum_full;
+	uint32_t arg;
+	uint32_t arg_offset;
+	uint32_t op;
+	uint32_t op_orig;
+	uint32_t mask;
+	uint32_t datum;
+	uint32_t act_t;
+	uint32_t act_f;
+	uint32_t lvl_nxt;
+	uint32_t nxt_t;
+	uint32_t nxt_f;
+	uint8_t arg_h_flg;
+	uint8_t act_t_flg;
+	uint8_t act_f_flg;
+	uint8_t pad;
+};
+
+struct db_img_rule {
+	uint32_t action;
+	int32_t syscall;
+	uint32_t strict;
+	uint32_t arg_cnt;
+};
+
+struct db_img_arg {
+	uint64_t mask;
+	uint64_t datum;
+	uint32_t arg;
+	uint32_t op;
+};
+
+/* node to image index map used when exporting a filter */
+struct db_img_map {
+	struct db_arg_chain_tree **nodes;
+	unsigned int node_cnt;
+	uint32_t *slots;
+	unsigned int slot_cnt;
+};
+
+/* the filter attributes saved in a filter DB image */
+static const enum scmp_filter_attr _db_img_attrs[] = {
+	SCMP_FLTATR_ACT_DEFAULT,
+	SCMP_FLTATR_ACT_BADARCH,
+	SCMP_FLTATR_CTL_NNP,
+	SCMP_FLTATR_CTL_TSYNC,
+	SCMP_FLTATR_API_TSKIP,
+	SCMP_FLTATR_CTL_LOG,
+	SCMP_FLTATR_CTL_SSB,
+	SCMP_FLTATR_CTL_OPTIMIZE,
+	SCMP_FLTATR_API_SYSRAWRC,
+	SCMP_FLTATR_CTL_WAITKILL,
+	SCMP_FLTATR_CTL_MINIMIZE,
+	SCMP_FLTATR_CTL_CACHE,
+};
+#define _DB_IMG_ATTR_CNT \
+	(sizeof(_db_img_attrs) / sizeof(_db_img_attrs[0]))
+
+/* the filter attributes which change the generated program */
+static const enum scmp_filter_attr _db_prgm_attrs[] = {
+	SCMP_FLTATR_ACT_DEFAULT,
+	SCMP_FLTATR_ACT_BADARCH,
+	SCMP_FLTATR_API_TSKIP,
+	SCMP_FLTATR_CTL_OPTIMIZE,
+	SCMP_FLTATR_CTL_MINIMIZE,
+};
+#define _DB_PRGM_ATTR_CNT \
+	(sizeof(_db_prgm_attrs) / sizeof(_db_prgm_attrs[0]))
+
+/* process-wide shared program cache */
+static struct db_prgm_cache *_db_prgm_cache[_DB_PRGM_CACHE_SLOTS];
+static unsigned int _db_prgm_cache_idle = 0;
+static uint64_t _db_prgm_cache_stamp = 0;
+static char _db_prgm_cache_lck = 0;
+
 static unsigned int _db_node_put(struct db_arg_chain_tree **node);
+static int _db_img_map_build(struct db_img_map *map,
+			     const struct db_filter *db);
+static void _db_img_write(void *buf, size_t *off,
+			  const void *rec, size_t size);
+static void _db_img_tree_write(const struct db_filter *db,
+			       const struct db_img_map *map,
+			       void *buf, size_t *off);
 
 /**
  * Define the syscall argument priority for nodes on the same level of the tree
@@ -335,7 +492,7 @@ static unsigned int _db_node_put(struct db_arg_chain_tree **node)
 		cnt += _db_tree_put(&nxt_f);
 
 		/* cleanup and accounting */
-		free(n);
+		zfree(n);
 		cnt++;
 	}
 
@@ -837,7 +994,7 @@ static void _db_reset(struct db_filter *db)
 		while (s_iter != NULL) {
 			db->syscalls = s_iter->next;
 			_db_tree_put(&s_iter->chains);
-			free(s_iter);
+			zfree(s_iter);
 			s_iter = db->syscalls;
 		}
 		db->syscalls = NULL;
@@ -851,7 +1008,7 @@ static void _db_reset(struct db_filter *db)
 		r_iter = db->rules;
 		while (r_iter != NULL) {
 			db->rules = r_iter->next;
-			free(r_iter);
+			zfree(r_iter);
 			r_iter = db->rules;
 		}
 		db->rules = NULL;
@@ -896,7 +1053,7 @@ static void _db_release(struct db_filter *db)
 
 	/* free and reset the DB */
 	_db_reset(db);
-	free(db);
+	zfree(db);
 }
 
 /**
@@ -919,9 +1076,9 @@ static void _db_snap_release(struct db_filter_snap *snap)
 			if (snap->filters[iter])
 				_db_release(snap->filters[iter]);
 		}
-		free(snap->filters);
+		zfree(snap->filters);
 	}
-	free(snap);
+	zfree(snap);
 }
 
 /**
@@ -966,6 +1123,57 @@ static int _db_syscall_priority(struct db_filter *db,
 		return -ENOMEM;
 	s_new->num = syscall;
 	s_new->priority = sys_pri;
+	s_new->weight = _DB_WEIGHT_DEFAULT;
+	s_new->valid = false;
+
+	/* add it before s_iter */
+	if (s_prev != NULL) {
+		s_new->next = s_prev->next;
+		s_prev->next = s_new;
+	} else {
+		s_new->next = db->syscalls;
+		db->syscalls = s_new;
+	}
+
+	return 0;
+}
+
+/**
+ * Set the syscall weight
+ * @param db the seccomp filter db
+ * @param syscall the syscall number
+ * @param weight the syscall weight
+ *
+ * This function sets the syscall weight, replacing any existing value.  If the
+ * syscall entry does not already exist, a new phantom syscall entry is created
+ * as a placeholder.  Returns zero on success, negative values on failure.
+ *
+ */
+static int _db_syscall_weight(struct db_filter *db,
+			      int syscall, uint32_t weight)
+{
+	struct db_sys_list *s_new, *s_iter, *s_prev = NULL;
+
+	assert(db != NULL);
+
+	s_iter = db->syscalls;
+	while (s_iter != NULL && s_iter->num < syscall) {
+		s_prev = s_iter;
+		s_iter = s_iter->next;
+	}
+
+	/* matched an existing syscall entry */
+	if (s_iter != NULL && s_iter->num == syscall) {
+		s_iter->weight = weight;
+		return 0;
+	}
+
+	/* no existing syscall entry - create a phantom entry */
+	s_new = zmalloc(sizeof(*s_new));
+	if (s_new == NULL)
+		return -ENOMEM;
+	s_new->num = syscall;
+	s_new->weight = weight;
 	s_new->valid = false;
 
 	/* add it before s_iter */
@@ -993,7 +1201,7 @@ static int _db_syscall_priority(struct db_filter *db,
  */
 static struct db_api_rule_list *_db_rule_new(bool strict,
 					     uint32_t action, int syscall,
-					     struct db_api_arg *chain)
+					     const struct db_api_arg *chain)
 {
 	struct db_api_rule_list *rule;
 
@@ -1021,7 +1229,7 @@ struct db_api_rule_list *db_rule_dup(const struct db_api_rule_list *src)
 {
 	struct db_api_rule_list *dest;
 
-	dest = malloc(sizeof(*dest));
+	dest = zmalloc(sizeof(*dest));
 	if (dest == NULL)
 		return NULL;
 	memcpy(dest, src, sizeof(*dest));
@@ -1056,7 +1264,7 @@ int db_col_reset(struct db_filter_col *col, uint32_t def_action)
 		_db_release(col->filters[iter]);
 	col->filter_cnt = 0;
 	if (col->filters)
-		free(col->filters);
+		zfree(col->filters);
 	col->filters = NULL;
 
 	/* set the endianness to undefined */
@@ -1073,6 +1281,8 @@ int db_col_reset(struct db_filter_col *col, uint32_t def_action)
 	col->attr.optimize = 1;
 	col->attr.api_sysrawrc = 0;
 	col->attr.wait_killable_recv = 0;
+	col->attr.minimize = 0;
+	col->attr.cache_enable = 0;
 
 	/* set the state */
 	col->state = _DB_STA_VALID;
@@ -1096,8 +1306,8 @@ int db_col_reset(struct db_filter_col *col, uint32_t def_action)
 		col->snapshots = snap->next;
 		for (iter = 0; iter < snap->filter_cnt; iter++)
 			_db_release(snap->filters[iter]);
-		free(snap->filters);
-		free(snap);
+		zfree(snap->filters);
+		zfree(snap);
 	}
 
 	/* reset the precomputed programs */
@@ -1116,14 +1326,22 @@ int db_col_reset(struct db_filter_col *col, uint32_t def_action)
  */
 struct db_filter_col *db_col_init(uint32_t def_action)
 {
+	int rc;
 	struct db_filter_col *col;
+	struct mem_acct *acct;
 
 	col = zmalloc(sizeof(*col));
 	if (col == NULL)
 		return NULL;
 
+	/* the collection is charged for its own memory */
+	col->mem.used = zsize(col);
+
 	/* reset the DB to a known state */
-	if (db_col_reset(col, def_action) < 0) {
+	acct = mem_acct_swap(&col->mem);
+	rc = db_col_reset(col, def_action);
+	mem_acct_swap(acct);
+	if (rc < 0) {
 		db_col_release(col);
 		return NULL;
 	}
@@ -1162,14 +1380,17 @@ void db_col_release(struct db_filter_col *col)
 		_db_release(col->filters[iter]);
 	col->filter_cnt = 0;
 	if (col->filters)
-		free(col->filters);
+		zfree(col->filters);
 	col->filters = NULL;
 
 	/* free any precompute */
 	db_col_precompute_reset(col);
 
+	/* free the allocators, all of the memory they allocated is gone */
+	mem_acct_alloc_release(&col->mem);
+
 	/* free the collection */
-	free(col);
+	zfree(col);
 }
 
 /**
@@ -1241,10 +1462,17 @@ int db_col_merge(struct db_filter_col *col_dst, struct db_filter_col *col_src)
 		}
 	}
 
+	/* make sure the destination can take on the source's memory */
+	if (col_dst->mem.limit > 0 &&
+	    (col_src->mem.used > col_dst->mem.limit ||
+	     col_dst->mem.used > col_dst->mem.limit - col_src->mem.used))
+		return -ENOMEM;
+
 	/* expand the destination */
-	dbs = realloc(col_dst->filters,
-		      sizeof(struct db_filter *) *
-		      (col_dst->filter_cnt + col_src->filter_cnt));
+	dbs = zrealloc(col_dst->filters,
+		       sizeof(struct db_filter *) * col_dst->filter_cnt,
+		       sizeof(struct db_filter *) *
+		       (col_dst->filter_cnt + col_src->filter_cnt));
 	if (dbs == NULL)
 		return -ENOMEM;
 	col_dst->filters = dbs;
@@ -1259,7 +1487,10 @@ int db_col_merge(struct db_filter_col *col_dst, struct db_filter_col *col_src)
 	/* reset the precompute */
 	db_col_precompute_reset(col_dst);
 
-	/* free the source */
+	/* free the source, the destination is charged for what remains */
+	col_dst->mem.used += col_src->mem.used;
+	col_src->mem.used = 0;
+	mem_acct_alloc_move(&col_dst->mem, &col_src->mem);
 	col_src->filter_cnt = 0;
 	db_col_release(col_src);
 
@@ -1333,6 +1564,31 @@ int db_col_attr_get(const struct db_filter_col *col,
 	case SCMP_FLTATR_CTL_WAITKILL:
 		*value = col->attr.wait_killable_recv;
 		break;
+	case SCMP_FLTATR_CTL_MINIMIZE:
+		*value = col->attr.minimize;
+		break;
+	case SCMP_FLTATR_STAT_MIN_NODES:
+		*value = col->prgm_stats.min_nodes;
+		break;
+	case SCMP_FLTATR_STAT_MIN_INSNS:
+		*value = col->prgm_stats.min_insns;
+		break;
+	case SCMP_FLTATR_STAT_COST_BEFORE:
+		*value = col->prgm_stats.cost_before;
+		break;
+	case SCMP_FLTATR_STAT_COST_AFTER:
+		*value = col->prgm_stats.cost_after;
+		break;
+	case SCMP_FLTATR_STAT_MEM_USED:
+		*value = (col->mem.used > UINT32_MAX ?
+			  UINT32_MAX : col->mem.used);
+		break;
+	case SCMP_FLTATR_CTL_MEM_MAX:
+		*value = col->mem.limit;
+		break;
+	case SCMP_FLTATR_CTL_CACHE:
+		*value = col->attr.cache_enable;
+		break;
 	default:
 		rc = -EINVAL;
 		break;
@@ -1435,6 +1691,7 @@ int db_col_attr_set(struct db_filter_col *col,
 		switch (value) {
 		case 1:
 		case 2:
+		case 3:
 			col->attr.optimize = value;
 			break;
 		default:
@@ -1449,6 +1706,24 @@ int db_col_attr_set(struct db_filter_col *col,
 	case SCMP_FLTATR_CTL_WAITKILL:
 		col->attr.wait_killable_recv = (value ? 1 : 0);
 		break;
+	case SCMP_FLTATR_CTL_MINIMIZE:
+		col->attr.minimize = (value ? 1 : 0);
+		db_col_precompute_reset(col);
+		break;
+	case SCMP_FLTATR_CTL_MEM_MAX:
+		col->mem.limit = value;
+		break;
+	case SCMP_FLTATR_CTL_CACHE:
+		col->attr.cache_enable = (value ? 1 : 0);
+		break;
+	case SCMP_FLTATR_STAT_MIN_NODES:
+	case SCMP_FLTATR_STAT_MIN_INSNS:
+	case SCMP_FLTATR_STAT_MEM_USED:
+	case SCMP_FLTATR_STAT_COST_BEFORE:
+	case SCMP_FLTATR_STAT_COST_AFTER:
+		/* read only */
+		return -EACCES;
+		break;
 	default:
 		rc = -EINVAL;
 		break;
@@ -1504,8 +1779,9 @@ int db_col_db_add(struct db_filter_col *col, struct db_filter *db)
 	if (db_col_arch_exist(col, db->arch->token))
 		return -EEXIST;
 
-	dbs = realloc(col->filters,
-		      sizeof(struct db_filter *) * (col->filter_cnt + 1));
+	dbs = zrealloc(col->filters,
+		       sizeof(struct db_filter *) * col->filter_cnt,
+		       sizeof(struct db_filter *) * (col->filter_cnt + 1));
 	if (dbs == NULL)
 		return -ENOMEM;
 	col->filters = dbs;
@@ -1548,14 +1824,15 @@ int db_col_db_remove(struct db_filter_col *col, uint32_t arch_token)
 	if (col->filter_cnt > 0) {
 		/* NOTE: if we can't do the realloc it isn't fatal, we just
 		 *       have some extra space allocated */
-		dbs = realloc(col->filters,
-			      sizeof(struct db_filter *) * col->filter_cnt);
+		dbs = zrealloc(col->filters,
+			       sizeof(struct db_filter *) * (col->filter_cnt + 1),
+			       sizeof(struct db_filter *) * col->filter_cnt);
 		if (dbs != NULL)
 			col->filters = dbs;
 	} else {
 		/* this was the last filter so free all the associated memory
 		 * and reset the endian token */
-		free(col->filters);
+		zfree(col->filters);
 		col->filters = NULL;
 		col->endian = 0;
 	}
@@ -1641,8 +1918,6 @@ static struct db_sys_list *_db_rule_gen_64(const struct arch_def *arch,
 		if (chain[iter].valid == 0)
 			continue;
 
-		/* TODO: handle the case were either hi or lo isn't needed */
-
 		/* skip generating instruction which are no-ops */
 		if (!_db_arg_cmp_need_hi(&chain[iter]) &&
 		    !_db_arg_cmp_need_lo(&chain[iter]))
@@ -1653,7 +1928,7 @@ static struct db_sys_list *_db_rule_gen_64(const struct arch_def *arch,
 			goto gen_64_failure;
 		c_iter[1] = zmalloc(sizeof(*c_iter[1]));
 		if (c_iter[1] == NULL) {
-			free(c_iter[0]);
+			zfree(c_iter[0]);
 			goto gen_64_failure;
 		}
 		c_iter[2] = NULL;
@@ -1787,8 +2062,8 @@ static struct db_sys_list *_db_rule_gen_64(const struct arch_def *arch,
 		case SCMP_CMP_LT:
 			c_iter[2] = zmalloc(sizeof(*c_iter[2]));
 			if (c_iter[2] == NULL) {
-				free(c_iter[0]);
-				free(c_iter[1]);
+				zfree(c_iter[0]);
+				zfree(c_iter[1]);
 				goto gen_64_failure;
 			}
 
@@ -1860,8 +2135,16 @@ static struct db_sys_list *_db_rule_gen_64(const struct arch_def *arch,
 
 			switch (chain[iter].op) {
 			case SCMP_CMP_MASKED_EQ:
-				c_iter[0]->op = SCMP_CMP_MASKED_EQ;
-				c_iter[1]->op = SCMP_CMP_MASKED_EQ;
+				/* a word with a full mask is a plain equality
+				 * test, using SCMP_CMP_EQ allows the node to be
+				 * merged with any sibling equality tests of the
+				 * same word */
+				c_iter[0]->op = (c_iter[0]->mask == ARG_MASK_MAX ?
+						 SCMP_CMP_EQ :
+						 SCMP_CMP_MASKED_EQ);
+				c_iter[1]->op = (c_iter[1]->mask == ARG_MASK_MAX ?
+						 SCMP_CMP_EQ :
+						 SCMP_CMP_MASKED_EQ);
 				break;
 			default:
 				c_iter[0]->op = SCMP_CMP_EQ;
@@ -1870,7 +2153,19 @@ static struct db_sys_list *_db_rule_gen_64(const struct arch_def *arch,
 			c_iter[0]->op_orig = chain[iter].op;
 			c_iter[1]->op_orig = chain[iter].op;
 
-			c_iter[0]->nxt_t = _db_node_get(c_iter[1]);
+			if (!_db_arg_cmp_need_hi(&chain[iter])) {
+				/* the high word test always passes, keep the
+				 * low word test where the high word test would
+				 * have been sorted */
+				zfree(c_iter[0]);
+				c_iter[0] = c_iter[1];
+				c_iter[0]->arg_h_flg = true;
+			} else if (!_db_arg_cmp_need_lo(&chain[iter])) {
+				/* the low word test always passes */
+				zfree(c_iter[1]);
+				c_iter[1] = c_iter[0];
+			} else
+				c_iter[0]->nxt_t = _db_node_get(c_iter[1]);
 			break;
 		default:
 			/* we should never get here */
@@ -1910,7 +2205,7 @@ static struct db_sys_list *_db_rule_gen_64(const struct arch_def *arch,
 		case SCMP_CMP_NE:
 		case SCMP_CMP_EQ:
 		case SCMP_CMP_MASKED_EQ:
-			s_new->node_cnt += 2;
+			s_new->node_cnt += (c_iter[0] == c_iter[1] ? 1 : 2);
 			break;
 		default:
 			s_new->node_cnt += 3;
@@ -1962,7 +2257,7 @@ static struct db_sys_list *_db_rule_gen_64(const struct arch_def *arch,
 gen_64_failure:
 	/* free the new chain and its syscall struct */
 	_db_tree_put(&s_new->chains);
-	free(s_new);
+	zfree(s_new);
 	return NULL;
 }
 
@@ -2061,7 +2356,7 @@ static struct db_sys_list *_db_rule_gen_32(const struct arch_def *arch,
 gen_32_failure:
 	/* free the new chain and its syscall struct */
 	_db_tree_put(&s_new->chains);
-	free(s_new);
+	zfree(s_new);
 	return NULL;
 }
 
@@ -2109,6 +2404,7 @@ int db_rule_add(struct db_filter *db, const struct db_api_rule_list *rule)
 		s_iter = s_iter->next;
 	}
 	s_new->priority = _DB_PRI_MASK_CHAIN - s_new->node_cnt;
+	s_new->weight = _DB_WEIGHT_DEFAULT;
 add_reset:
 	if (s_iter == NULL || s_iter->num != rule->syscall) {
 		/* new syscall, add before s_iter */
@@ -2133,7 +2429,7 @@ add_reset:
 			if (s_iter->valid)
 				s_iter->priority = s_new->priority;
 			s_iter->valid = true;
-			free(s_new);
+			zfree(s_new);
 			rc = 0;
 			goto add_priority_update;
 		} else {
@@ -2141,7 +2437,7 @@ add_reset:
 			 * is at least as large as the new entry so cleanup and
 			 * exit */
 			_db_tree_put(&s_new->chains);
-			free(s_new);
+			zfree(s_new);
 			goto add_free_ok;
 		}
 	} else if (s_iter->chains != NULL && s_new->chains == NULL) {
@@ -2154,7 +2450,7 @@ add_reset:
 
 		/* cleanup the new tree and return */
 		_db_tree_put(&s_new->chains);
-		free(s_new);
+		zfree(s_new);
 		goto add_free_ok;
 	}
 
@@ -2173,7 +2469,7 @@ add_reset:
 	} else if ((state.flags & _DB_IST_M_REDUNDANT) == _DB_IST_M_REDUNDANT) {
 		/* the existing tree is "shorter", drop the new one */
 		_db_tree_put(&s_new->chains);
-		free(s_new);
+		zfree(s_new);
 		goto add_free_ok;
 	}
 
@@ -2185,7 +2481,7 @@ add_reset:
 		goto add_failure;
 	s_iter->node_cnt += s_new->node_cnt;
 	s_iter->node_cnt -= _db_tree_put(&s_new->chains);
-	free(s_new);
+	zfree(s_new);
 
 add_free_ok:
 	rc = 0;
@@ -2201,7 +2497,7 @@ add_failure:
 	/* NOTE: another reminder that we don't do any db error recovery here,
 	 * use the transaction mechanism as previously mentioned */
 	_db_tree_put(&s_new->chains);
-	free(s_new);
+	zfree(s_new);
 	return rc;
 }
 
@@ -2262,25 +2558,72 @@ priority_failure:
 }
 
 /**
- * Add a new rule to a single filter
+ * Set the weight of a given syscall
+ * @param col the filter collection
+ * @param syscall the syscall number
+ * @param weight the relative hit frequency of the syscall
+ *
+ * This function sets the weight of the given syscall; when the filter is
+ * generated with SCMP_FLTATR_CTL_OPTIMIZE level 3 this value is used to order
+ * the syscalls in the filter such that the expected filter code overhead is
+ * minimized.  Returns zero on success, negative values on failure.
+ *
+ */
+int db_col_syscall_weight(struct db_filter_col *col,
+			  int syscall, uint32_t weight)
+{
+	int rc = 0, rc_tmp;
+	unsigned int iter;
+	int sc_tmp;
+	struct db_filter *filter;
+
+	for (iter = 0; iter < col->filter_cnt; iter++) {
+		filter = col->filters[iter];
+		sc_tmp = syscall;
+
+		rc_tmp = arch_syscall_translate(filter->arch, &sc_tmp);
+		if (rc_tmp < 0)
+			goto weight_failure;
+
+		/* as with the syscall priority, weights are a "best effort"
+		 * thing so skip any architectures where the pseudo syscall
+		 * can not be rewritten */
+		if (sc_tmp < -1) {
+			rc_tmp = arch_syscall_rewrite(filter->arch, &sc_tmp);
+			if (rc_tmp == -EDOM)
+				continue;
+			if (rc_tmp < 0)
+				goto weight_failure;
+		}
+
+		rc_tmp = _db_syscall_weight(filter, sc_tmp, weight);
+
+weight_failure:
+		if (rc == 0 && rc_tmp < 0)
+			rc = rc_tmp;
+	}
+
+	if (rc == 0)
+		db_col_precompute_reset(col);
+
+	return rc;
+}
+
+/**
+ * Append a rule to a filter's rule list
  * @param filter the filter
  * @param rule the filter rule
  *
- * This is a helper function for db_col_rule_add() and similar functions, it
- * isn't generally useful.  Returns zero on success, negative values on error.
+ * This is a helper function for _db_col_rule_add() and
+ * db_col_rule_add_batch(), it only records the rule in the filter's rule list,
+ * the caller is responsible for adding the rule to the filter itself.
  *
  */
-static int _db_col_rule_add(struct db_filter *filter,
-			    struct db_api_rule_list *rule)
+static void _db_col_rule_link(struct db_filter *filter,
+			      struct db_api_rule_list *rule)
 {
-	int rc;
 	struct db_api_rule_list *iter;
 
-	/* add the rule to the filter */
-	rc = arch_filter_rule_add(filter, rule);
-	if (rc != 0)
-		return rc;
-
 	/* insert the chain to the end of the rule list */
 	iter = rule;
 	while (iter->next)
@@ -2295,6 +2638,79 @@ static int _db_col_rule_add(struct db_filter *filter,
 		iter->next = rule;
 		filter->rules = rule;
 	}
+}
+
+/**
+ * Add a new rule to a single filter
+ * @param filter the filter
+ * @param rule the filter rule
+ *
+ * This is a helper function for db_col_rule_add() and similar functions, it
+ * isn't generally useful.  Returns zero on success, negative values on error.
+ *
+ */
+static int _db_col_rule_add(struct db_filter *filter,
+			    struct db_api_rule_list *rule)
+{
+	int rc;
+
+	/* add the rule to the filter */
+	rc = arch_filter_rule_add(filter, rule);
+	if (rc != 0)
+		return rc;
+
+	_db_col_rule_link(filter, rule);
+	return 0;
+}
+
+/**
+ * Build the argument filter chain for a rule
+ * @param arg_cnt the number of argument filters in the argument filter chain
+ * @param arg_array the argument filter chain, (uint, enum scmp_compare, ulong)
+ * @param chain the zeroed destination chain, ARG_COUNT_MAX entries long
+ *
+ * This function converts the argument comparisons passed to the API into the
+ * internal argument filter chain format.  Returns zero on success, negative
+ * values on failure.
+ *
+ */
+static int _db_rule_chain(unsigned int arg_cnt,
+			  const struct scmp_arg_cmp *arg_array,
+			  struct db_api_arg *chain)
+{
+	unsigned int iter;
+	unsigned int arg_num;
+	struct scmp_arg_cmp arg_data;
+
+	for (iter = 0; iter < arg_cnt; iter++) {
+		arg_data = arg_array[iter];
+		arg_num = arg_data.arg;
+		if (arg_num >= ARG_COUNT_MAX || chain[arg_num].valid != 0)
+			return -EINVAL;
+
+		chain[arg_num].valid = 1;
+		chain[arg_num].arg = arg_num;
+		chain[arg_num].op = arg_data.op;
+		/* TODO: we should check datum/mask size against the
+		 *	 arch definition, e.g. 64 bit datum on x86 */
+		switch (chain[arg_num].op) {
+		case SCMP_CMP_NE:
+		case SCMP_CMP_LT:
+		case SCMP_CMP_LE:
+		case SCMP_CMP_EQ:
+		case SCMP_CMP_GE:
+		case SCMP_CMP_GT:
+			chain[arg_num].mask = DATUM_MAX;
+			chain[arg_num].datum = arg_data.datum_a;
+			break;
+		case SCMP_CMP_MASKED_EQ:
+			chain[arg_num].mask = arg_data.datum_a;
+			chain[arg_num].datum = arg_data.datum_b;
+			break;
+		default:
+			return -EINVAL;
+		}
+	}
 
 	return 0;
 }
@@ -2323,50 +2739,23 @@ int db_col_rule_add(struct db_filter_col *col,
 {
 	int rc = 0, rc_tmp;
 	unsigned int iter;
-	unsigned int arg_num;
 	size_t chain_size;
 	struct db_api_arg *chain = NULL;
-	struct scmp_arg_cmp arg_data;
 	struct db_api_rule_list *rule;
 	struct db_filter *db;
 
+	TRACE4(rule_add_entry, col, action, syscall, arg_cnt);
+
 	/* collect the arguments for the filter rule */
 	chain_size = sizeof(*chain) * ARG_COUNT_MAX;
 	chain = zmalloc(chain_size);
-	if (chain == NULL)
-		return -ENOMEM;
-	for (iter = 0; iter < arg_cnt; iter++) {
-		arg_data = arg_array[iter];
-		arg_num = arg_data.arg;
-		if (arg_num < ARG_COUNT_MAX && chain[arg_num].valid == 0) {
-			chain[arg_num].valid = 1;
-			chain[arg_num].arg = arg_num;
-			chain[arg_num].op = arg_data.op;
-			/* TODO: we should check datum/mask size against the
-			 *	 arch definition, e.g. 64 bit datum on x86 */
-			switch (chain[arg_num].op) {
-			case SCMP_CMP_NE:
-			case SCMP_CMP_LT:
-			case SCMP_CMP_LE:
-			case SCMP_CMP_EQ:
-			case SCMP_CMP_GE:
-			case SCMP_CMP_GT:
-				chain[arg_num].mask = DATUM_MAX;
-				chain[arg_num].datum = arg_data.datum_a;
-				break;
-			case SCMP_CMP_MASKED_EQ:
-				chain[arg_num].mask = arg_data.datum_a;
-				chain[arg_num].datum = arg_data.datum_b;
-				break;
-			default:
-				rc = -EINVAL;
-				goto add_return;
-			}
-		} else {
-			rc = -EINVAL;
-			goto add_return;
-		}
+	if (chain == NULL) {
+		rc = -ENOMEM;
+		goto add_return;
 	}
+	rc = _db_rule_chain(arg_cnt, arg_array, chain);
+	if (rc < 0)
+		goto add_return;
 
 	/* create a checkpoint */
 	rc = db_col_transaction_start(col);
@@ -2387,7 +2776,7 @@ int db_col_rule_add(struct db_filter_col *col,
 		/* add the rule */
 		rc_tmp = _db_col_rule_add(db, rule);
 		if (rc_tmp != 0)
-			free(rule);
+			zfree(rule);
 
 add_arch_fail:
 		if (rc_tmp != 0 && rc == 0)
@@ -2408,47 +2797,233 @@ add_return:
 		db_col_precompute_reset(col);
 	}
 	if (chain != NULL)
-		free(chain);
+		zfree(chain);
+	TRACE2(rule_add_return, col, rc);
 	return rc;
 }
 
 /**
- * Start a new seccomp filter transaction
- * @param col the filter collection
+ * Compare two batch entries by syscall number
+ * @param a the first batch entry
+ * @param b the second batch entry
  *
- * This function starts a new seccomp filter transaction for the given filter
- * collection.  Returns zero on success, negative values on failure.
+ * This is a qsort() helper for _db_col_rule_add_batch(), it orders the entries
+ * by descending syscall number, falling back to the original rule order so
+ * that rules for the same syscall are added in the order they were given.
  *
  */
-int db_col_transaction_start(struct db_filter_col *col)
+static int _db_batch_cmp(const void *a, const void *b)
 {
-	int rc;
-	unsigned int iter;
-	struct db_filter_snap *snap;
-	struct db_filter *filter_o, *filter_s;
-	struct db_api_rule_list *rule_o, *rule_s = NULL;
+	const struct db_batch_ent *e_a = a;
+	const struct db_batch_ent *e_b = b;
 
-	/* check to see if a shadow snapshot exists */
-	if (col->snapshots && col->snapshots->shadow) {
-		/* we have a shadow!  this will be easy */
+	if (e_a->syscall != e_b->syscall)
+		return (e_a->syscall > e_b->syscall ? -1 : 1);
+	if (e_a->idx != e_b->idx)
+		return (e_a->idx < e_b->idx ? -1 : 1);
+	return 0;
+}
 
-		/* NOTE: we don't bother to do any verification of the shadow
-		 *       because we start a new transaction every time we add
-		 *       a new rule to the filter(s); if this ever changes we
-		 *       will need to add a mechanism to verify that the shadow
-		 *       transaction is current/correct */
+/**
+ * Add a batch of rules to a single filter
+ * @param filter the filter
+ * @param rules the rules
+ * @param chains the argument filter chains for the rules
+ * @param rule_new scratch space for rule_cnt rule pointers
+ * @param order scratch space for rule_cnt batch entries
+ * @param rule_cnt the number of rules
+ *
+ * This is a helper function for db_col_rule_add_batch().  Each syscall entry
+ * in a filter is kept in a list sorted by syscall number, so adding the rules
+ * in descending syscall order turns the list search into a constant time
+ * operation for an empty filter.  Architectures with a rule_add() callback
+ * may touch multiple syscall entries for a single rule, e.g. multiplexed
+ * socket syscalls, so we preserve the original order there.  Each syscall is
+ * only translated once per filter.  On failure none
+ * of the new rules are recorded in the filter's rule list and the filter
+ * itself may be corrupted.  Returns zero on success, negative values on error.
+ *
+ */
+static int _db_col_rule_add_batch(struct db_filter *filter,
+				  const struct scmp_rule *rules,
+				  const struct db_api_arg *chains,
+				  struct db_api_rule_list **rule_new,
+				  struct db_batch_ent *order,
+				  unsigned int rule_cnt)
+{
+	int rc = 0;
+	unsigned int iter;
+	bool sorted = (filter->arch->rule_add == NULL);
+
+	memset(rule_new, 0, sizeof(*rule_new) * rule_cnt);
+	for (iter = 0; iter < rule_cnt; iter++) {
+		rule_new[iter] = _db_rule_new(false,
+					      rules[iter].action,
+					      rules[iter].syscall,
+					      &chains[iter * ARG_COUNT_MAX]);
+		if (rule_new[iter] == NULL) {
+			rc = -ENOMEM;
+			goto batch_failure;
+		}
 
-		col->snapshots->shadow = false;
-		return 0;
+		order[iter].syscall = rules[iter].syscall;
+		order[iter].idx = iter;
+		rc = arch_syscall_translate(filter->arch, &order[iter].syscall);
+		if (rc < 0)
+			goto batch_failure;
+	}
+	if (sorted)
+		qsort(order, rule_cnt, sizeof(*order), _db_batch_cmp);
+
+	/* add the rules to the filter */
+	for (iter = 0; iter < rule_cnt; iter++) {
+		rc = arch_filter_rule_add_translated(filter,
+						     rule_new[order[iter].idx],
+						     order[iter].syscall);
+		if (rc != 0)
+			goto batch_failure;
 	}
 
-	/* allocate the snapshot */
-	snap = zmalloc(sizeof(*snap));
-	if (snap == NULL)
+	/* record the rules in the order they were given */
+	for (iter = 0; iter < rule_cnt; iter++) {
+		_db_col_rule_link(filter, rule_new[iter]);
+		rule_new[iter] = NULL;
+	}
+
+	return 0;
+
+batch_failure:
+	for (iter = 0; iter < rule_cnt; iter++) {
+		if (rule_new[iter] != NULL)
+			zfree(rule_new[iter]);
+	}
+	return rc;
+}
+
+/**
+ * Add a batch of rules to the current filter
+ * @param col the filter collection
+ * @param rules the rules
+ * @param rule_cnt the number of rules
+ *
+ * This function adds a series of rules to the seccomp filter, the result is
+ * the same as adding each rule with db_col_rule_add() in turn with the strict
+ * flag set to false, but the rules are added under a single transaction which
+ * is not shadowed, and the rules are inserted in an order that is cheap for
+ * the filter DB.  Either all of the rules are added or none of them are.
+ * Returns zero on success, negative values on failure.
+ *
+ */
+int db_col_rule_add_batch(struct db_filter_col *col,
+			  const struct scmp_rule *rules, unsigned int rule_cnt)
+{
+	int rc = 0;
+	unsigned int iter;
+	bool notify = false;
+	struct db_api_arg *chains = NULL;
+	struct db_api_rule_list **rule_new = NULL;
+	struct db_batch_ent *order = NULL;
+	struct db_filter_snap *snap;
+
+	if (rule_cnt == 0)
+		return 0;
+
+	TRACE2(rule_add_batch_entry, col, rule_cnt);
+
+	/* collect the arguments for all of the rules up front */
+	chains = zmalloc(sizeof(*chains) * ARG_COUNT_MAX * rule_cnt);
+	rule_new = zmalloc(sizeof(*rule_new) * rule_cnt);
+	order = zmalloc(sizeof(*order) * rule_cnt);
+	if (chains == NULL || rule_new == NULL || order == NULL) {
+		rc = -ENOMEM;
+		goto batch_return;
+	}
+	for (iter = 0; iter < rule_cnt; iter++) {
+		rc = _db_rule_chain(rules[iter].arg_cnt, rules[iter].arg_array,
+				    &chains[iter * ARG_COUNT_MAX]);
+		if (rc < 0)
+			goto batch_return;
+		if (rules[iter].action == SCMP_ACT_NOTIFY)
+			notify = true;
+	}
+
+	/* create a checkpoint */
+	rc = db_col_transaction_start(col);
+	if (rc != 0)
+		goto batch_return;
+
+	/* add the rules to the different filters in the collection */
+	for (iter = 0; iter < col->filter_cnt && rc == 0; iter++)
+		rc = _db_col_rule_add_batch(col->filters[iter], rules, chains,
+					    rule_new, order, rule_cnt);
+
+	if (rc == 0) {
+		/* NOTE: we drop the checkpoint rather than commit it as
+		 *       building a shadow would mean adding every rule in
+		 *       the batch a second time */
+		snap = col->snapshots;
+		col->snapshots = snap->next;
+		_db_snap_release(snap);
+		TRACE1(transaction_commit, col);
+	} else
+		db_col_transaction_abort(col);
+
+batch_return:
+	/* update the misc state */
+	if (rc == 0) {
+		if (notify)
+			col->notify_used = true;
+		db_col_precompute_reset(col);
+	}
+	if (order != NULL)
+		zfree(order);
+	if (rule_new != NULL)
+		zfree(rule_new);
+	if (chains != NULL)
+		zfree(chains);
+	TRACE2(rule_add_batch_return, col, rc);
+	return rc;
+}
+
+/**
+ * Start a new seccomp filter transaction
+ * @param col the filter collection
+ *
+ * This function starts a new seccomp filter transaction for the given filter
+ * collection.  Returns zero on success, negative values on failure.
+ *
+ */
+int db_col_transaction_start(struct db_filter_col *col)
+{
+	int rc;
+	unsigned int iter;
+	struct db_filter_snap *snap;
+	struct db_filter *filter_o, *filter_s;
+	struct db_api_rule_list *rule_o, *rule_s = NULL;
+
+	TRACE1(transaction_start, col);
+
+	/* check to see if a shadow snapshot exists */
+	if (col->snapshots && col->snapshots->shadow) {
+		/* we have a shadow!  this will be easy */
+
+		/* NOTE: we don't bother to do any verification of the shadow
+		 *       because we start a new transaction every time we add
+		 *       a new rule to the filter(s); if this ever changes we
+		 *       will need to add a mechanism to verify that the shadow
+		 *       transaction is current/correct */
+
+		col->snapshots->shadow = false;
+		return 0;
+	}
+
+	/* allocate the snapshot */
+	snap = zmalloc(sizeof(*snap));
+	if (snap == NULL)
 		return -ENOMEM;
 	snap->filters = zmalloc(sizeof(struct db_filter *) * col->filter_cnt);
 	if (snap->filters == NULL) {
-		free(snap);
+		zfree(snap);
 		return -ENOMEM;
 	}
 	snap->filter_cnt = col->filter_cnt;
@@ -2494,7 +3069,7 @@ int db_col_transaction_start(struct db_filter_col *col)
 
 trans_start_failure:
 	if (rule_s != NULL)
-		free(rule_s);
+		zfree(rule_s);
 	_db_snap_release(snap);
 	return -ENOMEM;
 }
@@ -2516,6 +3091,8 @@ void db_col_transaction_abort(struct db_filter_col *col)
 	if (col->snapshots == NULL)
 		return;
 
+	TRACE1(transaction_abort, col);
+
 	/* replace the current filter with the last snapshot */
 	snap = col->snapshots;
 	col->snapshots = snap->next;
@@ -2523,12 +3100,12 @@ void db_col_transaction_abort(struct db_filter_col *col)
 	filters = col->filters;
 	col->filter_cnt = snap->filter_cnt;
 	col->filters = snap->filters;
-	free(snap);
+	zfree(snap);
 
 	/* free the filter we swapped out */
 	for (iter = 0; iter < filter_cnt; iter++)
 		_db_release(filters[iter]);
-	free(filters);
+	zfree(filters);
 
 	/* free any precompute */
 	db_col_precompute_reset(col);
@@ -2555,6 +3132,8 @@ void db_col_transaction_commit(struct db_filter_col *col)
 	if (snap == NULL)
 		return;
 
+	TRACE1(transaction_commit, col);
+
 	/* check for a shadow set by a higher transaction commit */
 	if (snap->shadow) {
 		/* leave the shadow intact, but drop the next snapshot */
@@ -2571,8 +3150,9 @@ void db_col_transaction_commit(struct db_filter_col *col)
 		struct db_filter **tmp_f;
 
 		/* add filters */
-		tmp_f = realloc(snap->filters,
-				sizeof(struct db_filter *) * col->filter_cnt);
+		tmp_f = zrealloc(snap->filters,
+				 sizeof(struct db_filter *) * snap->filter_cnt,
+				 sizeof(struct db_filter *) * col->filter_cnt);
 		if (tmp_f == NULL)
 			goto shadow_err;
 		snap->filters = tmp_f;
@@ -2630,7 +3210,7 @@ void db_col_transaction_commit(struct db_filter_col *col)
 			/* add the rule */
 			rc = _db_col_rule_add(filter_s, rule_s);
 			if (rc != 0) {
-				free(rule_s);
+				zfree(rule_s);
 				goto shadow_err;
 			}
 
@@ -2650,32 +3230,1243 @@ shadow_err:
 	return;
 }
 
+/**
+ * Generate the canonical fingerprint of a filter collection
+ * @param col the filter collection
+ * @param key the fingerprint
+ * @param key_len the fingerprint length
+ *
+ * This function serializes everything the BPF generator depends on: the
+ * attributes which change the generated program, followed by each filter's
+ * architecture, syscall list and argument chain trees.  The rules themselves
+ * are left out as the syscall lists and trees are their normalized form, and
+ * the tree nodes are numbered by a walk of the trees so the fingerprint does
+ * not depend on where the nodes live in memory.  Two collections with the same
+ * fingerprint generate the same program.  The caller is responsible for
+ * freeing @key with zfree().  Returns zero on success, negative values on
+ * failure.
+ *
+ */
+static int _db_col_fingerprint(const struct db_filter_col *col,
+			       void **key, size_t *key_len)
+{
+	int rc = 0;
+	unsigned int iter;
+	size_t size, off = 0;
+	uint32_t value;
+	void *buf = NULL;
+	struct db_img_filter f_img;
+	struct db_img_map *maps;
+	struct db_sys_list *s_iter;
+	const struct db_filter *db;
+
+	maps = zmalloc(sizeof(*maps) * col->filter_cnt);
+	if (maps == NULL)
+		return -ENOMEM;
+
+	size = sizeof(value) * _DB_PRGM_ATTR_CNT;
+	for (iter = 0; iter < col->filter_cnt; iter++) {
+		db = col->filters[iter];
+		rc = _db_img_map_build(&maps[iter], db);
+		if (rc < 0)
+			goto fingerprint_out;
+		size += sizeof(f_img);
+		db_list_foreach(s_iter, db->syscalls)
+			size += sizeof(struct db_img_sys);
+		size += sizeof(struct db_img_node) * maps[iter].node_cnt;
+	}
+
+	buf = zmalloc(size);
+	if (buf == NULL) {
+		rc = -ENOMEM;
+		goto fingerprint_out;
+	}
+	for (iter = 0; iter < _DB_PRGM_ATTR_CNT; iter++) {
+		value = db_col_attr_read(col, _db_prgm_attrs[iter]);
+		_db_img_write(buf, &off, &value, sizeof(value));
+	}
+	for (iter = 0; iter < col->filter_cnt; iter++) {
+		db = col->filters[iter];
+		memset(&f_img, 0, sizeof(f_img));
+		f_img.arch = db->arch->token;
+		db_list_foreach(s_iter, db->syscalls)
+			f_img.sys_cnt++;
+		f_img.node_cnt = maps[iter].node_cnt;
+		_db_img_write(buf, &off, &f_img, sizeof(f_img));
+		_db_img_tree_write(db, &maps[iter], buf, &off);
+	}
+
+	*key = buf;
+	*key_len = size;
+
+fingerprint_out:
+	for (iter = 0; iter < col->filter_cnt; iter++) {
+		zfree(maps[iter].nodes);
+		zfree(maps[iter].slots);
+	}
+	zfree(maps);
+	return rc;
+}
+
+/**
+ * Lock the shared program cache
+ *
+ * The cache is shared by every filter collection in the process, the lock is
+ * only held while the cache is searched or updated, never while a program is
+ * generated.
+ *
+ */
+static void _db_prgm_cache_lock(void)
+{
+	while (__atomic_test_and_set(&_db_prgm_cache_lck, __ATOMIC_ACQUIRE))
+		;
+}
+
+/**
+ * Unlock the shared program cache
+ */
+static void _db_prgm_cache_unlock(void)
+{
+	__atomic_clear(&_db_prgm_cache_lck, __ATOMIC_RELEASE);
+}
+
+/**
+ * Free a shared program cache entry
+ * @param ent the cache entry
+ *
+ * The caller must have unlinked the entry and disabled memory accounting.
+ *
+ */
+static void _db_prgm_cache_free(struct db_prgm_cache *ent)
+{
+	gen_bpf_release(ent->prgm);
+	zfree(ent->key);
+	zfree(ent);
+}
+
+/**
+ * Evict the least recently used idle entry from the shared program cache
+ *
+ * Returns the evicted entry, which the caller must free, or NULL if there is
+ * no idle entry.  The caller must hold the cache lock.
+ *
+ */
+static struct db_prgm_cache *_db_prgm_cache_evict(void)
+{
+	unsigned int iter;
+	struct db_prgm_cache *ent, **ent_p, **victim_p = NULL;
+
+	for (iter = 0; iter < _DB_PRGM_CACHE_SLOTS; iter++) {
+		for (ent_p = &_db_prgm_cache[iter]; *ent_p != NULL;
+		     ent_p = &(*ent_p)->next) {
+			if ((*ent_p)->refcnt > 0)
+				continue;
+			if (victim_p == NULL ||
+			    (*ent_p)->stamp < (*victim_p)->stamp)
+				victim_p = ent_p;
+		}
+	}
+	if (victim_p == NULL)
+		return NULL;
+
+	ent = *victim_p;
+	*victim_p = ent->next;
+	_db_prgm_cache_idle--;
+	return ent;
+}
+
+/**
+ * Find a program in the shared program cache
+ * @param hash the fingerprint hash
+ * @param key the fingerprint
+ * @param key_len the fingerprint length
+ *
+ * Returns the matching cache entry with a new reference held by the caller,
+ * or NULL if the program is not cached.  The caller must hold the cache lock.
+ *
+ */
+static struct db_prgm_cache *_db_prgm_cache_find(uint32_t hash,
+						 const void *key,
+						 size_t key_len)
+{
+	struct db_prgm_cache *ent;
+
+	for (ent = _db_prgm_cache[hash % _DB_PRGM_CACHE_SLOTS]; ent != NULL;
+	     ent = ent->next) {
+		if (ent->hash != hash || ent->key_len != key_len ||
+		    memcmp(ent->key, key, key_len) != 0)
+			continue;
+		if (ent->refcnt++ == 0)
+			_db_prgm_cache_idle--;
+		ent->stamp = ++_db_prgm_cache_stamp;
+		return ent;
+	}
+
+	return NULL;
+}
+
+/**
+ * Get a program from the shared program cache
+ * @param hash the fingerprint hash
+ * @param key the fingerprint
+ * @param key_len the fingerprint length
+ *
+ * Returns the matching cache entry with a new reference held by the caller,
+ * or NULL if the program is not cached.
+ *
+ */
+static struct db_prgm_cache *_db_prgm_cache_get(uint32_t hash,
+						const void *key,
+						size_t key_len)
+{
+	struct db_prgm_cache *ent;
+
+	_db_prgm_cache_lock();
+	ent = _db_prgm_cache_find(hash, key, key_len);
+	_db_prgm_cache_unlock();
+
+	return ent;
+}
+
+/**
+ * Add a program to the shared program cache
+ * @param hash the fingerprint hash
+ * @param key the fingerprint
+ * @param key_len the fingerprint length
+ * @param prgm the program
+ * @param stats the program's minimization statistics
+ *
+ * This function adds a copy of the given program to the shared program cache,
+ * unless another filter collection added the same program first.  The cache
+ * entries outlive the filter collections which use them, so they are neither
+ * charged to nor allocated by any filter collection.  Returns the cache entry
+ * with a new reference held by the caller, or NULL on failure.
+ *
+ */
+static struct db_prgm_cache *_db_prgm_cache_put(uint32_t hash,
+						const void *key,
+						size_t key_len,
+						const struct bpf_program *prgm,
+						const struct db_filter_stats *stats)
+{
+	struct mem_acct *acct;
+	struct db_prgm_cache *ent, *dup;
+
+	acct = mem_acct_swap(NULL);
+
+	ent = zmalloc(sizeof(*ent));
+	if (ent == NULL)
+		goto put_err;
+	ent->key = zmalloc(key_len);
+	ent->prgm = zmalloc(sizeof(*ent->prgm));
+	if (ent->key == NULL || ent->prgm == NULL)
+		goto put_err;
+	ent->prgm->blks = zmalloc(BPF_PGM_SIZE(prgm));
+	if (ent->prgm->blks == NULL)
+		goto put_err;
+	memcpy(ent->prgm->blks, prgm->blks, BPF_PGM_SIZE(prgm));
+	ent->prgm->blk_cnt = prgm->blk_cnt;
+	memcpy(ent->key, key, key_len);
+	ent->key_len = key_len;
+	ent->hash = hash;
+	ent->stats = *stats;
+	ent->refcnt = 1;
+
+	_db_prgm_cache_lock();
+	dup = _db_prgm_cache_find(hash, key, key_len);
+	if (dup == NULL) {
+		ent->stamp = ++_db_prgm_cache_stamp;
+		ent->next = _db_prgm_cache[hash % _DB_PRGM_CACHE_SLOTS];
+		_db_prgm_cache[hash % _DB_PRGM_CACHE_SLOTS] = ent;
+	}
+	_db_prgm_cache_unlock();
+
+	if (dup != NULL) {
+		_db_prgm_cache_free(ent);
+		ent = dup;
+	}
+	mem_acct_swap(acct);
+	return ent;
+
+put_err:
+	if (ent != NULL) {
+		if (ent->prgm != NULL)
+			zfree(ent->prgm->blks);
+		zfree(ent->prgm);
+		zfree(ent->key);
+		zfree(ent);
+	}
+	mem_acct_swap(acct);
+	return NULL;
+}
+
+/**
+ * Drop a reference to a shared program cache entry
+ * @param ent the cache entry
+ *
+ * Entries without any references are kept so that later filter collections
+ * can still use them, but only up to a limit after which the least recently
+ * used idle entries are freed.
+ *
+ */
+static void _db_prgm_cache_drop(struct db_prgm_cache *ent)
+{
+	struct mem_acct *acct;
+	struct db_prgm_cache *victim = NULL;
+
+	_db_prgm_cache_lock();
+	if (--ent->refcnt == 0 &&
+	    ++_db_prgm_cache_idle > _DB_PRGM_CACHE_IDLE_MAX)
+		victim = _db_prgm_cache_evict();
+	_db_prgm_cache_unlock();
+
+	if (victim != NULL) {
+		acct = mem_acct_swap(NULL);
+		_db_prgm_cache_free(victim);
+		mem_acct_swap(acct);
+	}
+}
+
 /**
  * Precompute the seccomp filters
  * @param col the filter collection
  *
- * This function precomputes the seccomp filters before they are needed,
- * returns zero on success, negative values on error.
+ * This function precomputes the seccomp filters before they are needed, and
+ * minimizes them if requested.  If the shared program cache is enabled for
+ * the filter collection, and another filter collection with the same
+ * fingerprint has already been precomputed, the cached program is used
+ * instead of generating a new one; otherwise the new program is added to the
+ * cache.  Returns zero on success, negative values on error.
  *
  */
 int db_col_precompute(struct db_filter_col *col)
 {
-	if (!col->prgm_bpf)
-		return gen_bpf_generate(col, &col->prgm_bpf);
-	return 0;
+	int rc;
+	uint32_t key_hash = 0;
+	void *key = NULL;
+	size_t key_len = 0;
+	struct db_prgm_cache *ent;
+
+	if (col->prgm_bpf)
+		return 0;
+
+	TRACE1(precompute_begin, col);
+	if (col->attr.cache_enable) {
+		rc = _db_col_fingerprint(col, &key, &key_len);
+		if (rc < 0)
+			goto precompute_out;
+		key_hash = hash(key, key_len);
+		ent = _db_prgm_cache_get(key_hash, key, key_len);
+		if (ent != NULL) {
+			col->prgm_cache = ent;
+			col->prgm_bpf = ent->prgm;
+			col->prgm_stats = ent->stats;
+			goto precompute_out;
+		}
+	}
+
+	rc = gen_bpf_generate(col, &col->prgm_bpf, &col->prgm_stats);
+	if (rc >= 0 && col->attr.minimize) {
+		rc = gen_bpf_minimize(col, col->prgm_bpf, &col->prgm_stats);
+		if (rc < 0)
+			db_col_precompute_reset(col);
+	}
+
+	/* NOTE: if we can't add the program to the cache we simply keep our
+	 *       own copy, the cache is only an optimization */
+	if (rc >= 0 && key != NULL) {
+		ent = _db_prgm_cache_put(key_hash, key, key_len,
+					 col->prgm_bpf, &col->prgm_stats);
+		if (ent != NULL) {
+			gen_bpf_release(col->prgm_bpf);
+			col->prgm_cache = ent;
+			col->prgm_bpf = ent->prgm;
+			col->prgm_stats = ent->stats;
+		}
+	}
+
+precompute_out:
+	zfree(key);
+	TRACE3(precompute_end, col, rc,
+	       (col->prgm_bpf ? col->prgm_bpf->blk_cnt : 0));
+
+	return rc;
 }
 
 /**
  * Free any precomputed filter programs
  * @param col the filter collection
  *
- * This function releases any precomputed filter programs.
+ * This function releases any precomputed filter programs, or drops the
+ * reference to the shared program if it came from the program cache.
  */
 void db_col_precompute_reset(struct db_filter_col *col)
 {
 	if (!col->prgm_bpf)
 		return;
 
-	gen_bpf_release(col->prgm_bpf);
+	if (col->prgm_cache != NULL) {
+		_db_prgm_cache_drop(col->prgm_cache);
+		col->prgm_cache = NULL;
+	} else
+		gen_bpf_release(col->prgm_bpf);
 	col->prgm_bpf = NULL;
+	memset(&col->prgm_stats, 0, sizeof(col->prgm_stats));
+}
+
+/**
+ * Find a node's slot in a filter image node map
+ * @param map the node map
+ * @param node the tree node
+ *
+ * This is a helper function for db_col_export(), it returns the hash slot
+ * which holds @node's image index plus one, or the empty slot where it should
+ * be stored.
+ *
+ */
+static uint32_t *_db_img_map_slot(const struct db_img_map *map,
+				  const struct db_arg_chain_tree *node)
+{
+	unsigned int mask = map->slot_cnt - 1;
+	unsigned int iter;
+	uint32_t *slot;
+
+	iter = (((uintptr_t)node >> 4) * 2654435761U) & mask;
+	for (;;) {
+		slot = &map->slots[iter];
+		if (*slot == 0 || map->nodes[*slot - 1] == node)
+			return slot;
+		iter = (iter + 1) & mask;
+	}
+}
+
+/**
+ * Add a node to a filter image node map
+ * @param map the node map
+ * @param node the tree node, may be NULL
+ *
+ * This is a helper function for db_col_export(), it assigns the next image
+ * index to @node unless it already has one.  Returns zero on success,
+ * negative values on failure.
+ *
+ */
+static int _db_img_map_add(struct db_img_map *map,
+			   struct db_arg_chain_tree *node)
+{
+	unsigned int iter;
+	unsigned int slot_cnt;
+	uint32_t *slots;
+	struct db_arg_chain_tree **nodes;
+
+	if (node == NULL)
+		return 0;
+	if (map->slot_cnt > 0 && *_db_img_map_slot(map, node) != 0)
+		return 0;
+
+	/* keep the hash table at most half full */
+	if (map->node_cnt >= map->slot_cnt / 2) {
+		slot_cnt = (map->slot_cnt > 0 ? map->slot_cnt * 2 : 64);
+		nodes = zrealloc(map->nodes,
+				 sizeof(*nodes) * (map->slot_cnt / 2),
+				 sizeof(*nodes) * (slot_cnt / 2));
+		if (nodes == NULL)
+			return -ENOMEM;
+		map->nodes = nodes;
+		slots = zmalloc(sizeof(*slots) * slot_cnt);
+		if (slots == NULL)
+			return -ENOMEM;
+		zfree(map->slots);
+		map->slots = slots;
+		map->slot_cnt = slot_cnt;
+		for (iter = 0; iter < map->node_cnt; iter++)
+			*_db_img_map_slot(map, map->nodes[iter]) = iter + 1;
+	}
+
+	map->nodes[map->node_cnt++] = node;
+	*_db_img_map_slot(map, node) = map->node_cnt;
+
+	return 0;
+}
+
+/**
+ * Lookup a node's filter image index
+ * @param map the node map
+ * @param node the tree node, may be NULL
+ *
+ * Returns the image index of @node, or _DB_IMG_NONE if @node is NULL.
+ *
+ */
+static uint32_t _db_img_map_idx(const struct db_img_map *map,
+				const struct db_arg_chain_tree *node)
+{
+	if (node == NULL)
+		return _DB_IMG_NONE;
+	return *_db_img_map_slot(map, node) - 1;
+}
+
+/**
+ * Build a filter image node map
+ * @param map the zeroed node map
+ * @param db the filter
+ *
+ * This is a helper function for db_col_export(), it assigns an image index to
+ * every tree node reachable from the filter's syscall list.  Returns zero on
+ * success, negative values on failure.
+ *
+ */
+static int _db_img_map_build(struct db_img_map *map,
+			     const struct db_filter *db)
+{
+	int rc;
+	unsigned int iter;
+	struct db_sys_list *s_iter;
+	struct db_arg_chain_tree *node;
+
+	db_list_foreach(s_iter, db->syscalls) {
+		rc = _db_img_map_add(map, s_iter->chains);
+		if (rc < 0)
+			return rc;
+	}
+
+	/* NOTE: the node list grows as we walk it */
+	for (iter = 0; iter < map->node_cnt; iter++) {
+		node = map->nodes[iter];
+		rc = _db_img_map_add(map, node->lvl_prv);
+		if (rc == 0)
+			rc = _db_img_map_add(map, node->lvl_nxt);
+		if (rc == 0)
+			rc = _db_img_map_add(map, node->nxt_t);
+		if (rc == 0)
+			rc = _db_img_map_add(map, node->nxt_f);
+		if (rc < 0)
+			return rc;
+	}
+
+	return 0;
+}
+
+/**
+ * Count the argument comparisons in a rule
+ * @param rule the rule
+ *
+ * Returns the number of valid argument comparisons in the rule.
+ *
+ */
+static unsigned int _db_rule_arg_cnt(const struct db_api_rule_list *rule)
+{
+	unsigned int iter;
+	unsigned int cnt = 0;
+
+	for (iter = 0; iter < ARG_COUNT_MAX; iter++) {
+		if (rule->args[iter].valid)
+			cnt++;
+	}
+
+	return cnt;
+}
+
+/**
+ * Count the rules in a filter
+ * @param db the filter
+ * @param size the size of the rules' image records, may be NULL
+ *
+ * Returns the number of rules in the filter's rule list.
+ *
+ */
+static unsigned int _db_rule_cnt(const struct db_filter *db, size_t *size)
+{
+	unsigned int cnt = 0;
+	struct db_api_rule_list *iter;
+
+	iter = db->rules;
+	if (iter == NULL)
+		return 0;
+	do {
+		cnt++;
+		if (size != NULL)
+			*size += sizeof(struct db_img_rule) +
+				 sizeof(struct db_img_arg) *
+				 _db_rule_arg_cnt(iter);
+		iter = iter->next;
+	} while (iter != db->rules);
+
+	return cnt;
+}
+
+/**
+ * Write a record to a filter image
+ * @param buf the image buffer
+ * @param off the record offset, updated on return
+ * @param rec the record
+ * @param size the record size
+ *
+ */
+static void _db_img_write(void *buf, size_t *off,
+			  const void *rec, size_t size)
+{
+	memcpy((char *)buf + *off, rec, size);
+	*off += size;
+}
+
+/**
+ * Read a record from a filter image
+ * @param buf the image buffer
+ * @param len the image length
+ * @param off the record offset, updated on return
+ * @param rec the record
+ * @param size the record size
+ *
+ * Returns zero on success, -EINVAL if the image is truncated.
+ *
+ */
+static int _db_img_read(const void *buf, size_t len, size_t *off,
+			void *rec, size_t size)
+{
+	if (len - *off < size)
+		return -EINVAL;
+	memcpy(rec, (const char *)buf + *off, size);
+	*off += size;
+	return 0;
+}
+
+/**
+ * Write a filter's syscall list and argument chain trees to a filter image
+ * @param db the filter
+ * @param map the filter's node map
+ * @param buf the image buffer
+ * @param off the record offset, updated on return
+ *
+ * This is a helper function for db_col_export() and the program cache, it
+ * writes the syscall records followed by the tree node records.
+ *
+ */
+static void _db_img_tree_write(const struct db_filter *db,
+			       const struct db_img_map *map,
+			       void *buf, size_t *off)
+{
+	unsigned int iter;
+	struct db_img_sys s_img;
+	struct db_img_node n_img;
+	struct db_sys_list *s_iter;
+	struct db_arg_chain_tree *node;
+
+	db_list_foreach(s_iter, db->syscalls) {
+		memset(&s_img, 0, sizeof(s_img));
+		s_img.num = s_iter->num;
+		s_img.priority = s_iter->priority;
+		s_img.action = s_iter->action;
+		s_img.node_cnt = s_iter->node_cnt;
+		s_img.chains = _db_img_map_idx(map, s_iter->chains);
+		s_img.valid = s_iter->valid;
+		s_img.weight = s_iter->weight;
+		_db_img_write(buf, off, &s_img, sizeof(s_img));
+	}
+
+	for (iter = 0; iter < map->node_cnt; iter++) {
+		node = map->nodes[iter];
+		memset(&n_img, 0, sizeof(n_img));
+		n_img.datum_full = node->datum_full;
+		n_img.arg = node->arg;
+		n_img.arg_offset = node->arg_offset;
+		n_img.op = node->op;
+		n_img.op_orig = node->op_orig;
+		n_img.mask = node->mask;
+		n_img.datum = node->datum;
+		n_img.act_t = node->act_t;
+		n_img.act_f = node->act_f;
+		n_img.lvl_nxt = _db_img_map_idx(map, node->lvl_nxt);
+		n_img.nxt_t = _db_img_map_idx(map, node->nxt_t);
+		n_img.nxt_f = _db_img_map_idx(map, node->nxt_f);
+		n_img.arg_h_flg = node->arg_h_flg;
+		n_img.act_t_flg = node->act_t_flg;
+		n_img.act_f_flg = node->act_f_flg;
+		_db_img_write(buf, off, &n_img, sizeof(n_img));
+	}
+}
+
+/**
+ * Write a single filter to a filter image
+ * @param db the filter
+ * @param map the filter's node map
+ * @param buf the image buffer
+ * @param off the filter offset, updated on return
+ *
+ * This is a helper function for db_col_export(), see that function for a
+ * description of the filter image format.
+ *
+ */
+static void _db_img_filter_write(const struct db_filter *db,
+				 const struct db_img_map *map,
+				 void *buf, size_t *off)
+{
+	unsigned int iter, iter_a;
+	struct db_img_filter f_img;
+	struct db_img_rule r_img;
+	struct db_img_arg a_img;
+	struct db_sys_list *s_iter;
+	struct db_api_rule_list *r_iter;
+
+	memset(&f_img, 0, sizeof(f_img));
+	f_img.arch = db->arch->token;
+	f_img.syscall_cnt = db->syscall_cnt;
+	db_list_foreach(s_iter, db->syscalls)
+		f_img.sys_cnt++;
+	f_img.node_cnt = map->node_cnt;
+	f_img.rule_cnt = _db_rule_cnt(db, NULL);
+	_db_img_write(buf, off, &f_img, sizeof(f_img));
+
+	_db_img_tree_write(db, map, buf, off);
+
+	r_iter = db->rules;
+	for (iter = 0; iter < f_img.rule_cnt; iter++) {
+		memset(&r_img, 0, sizeof(r_img));
+		r_img.action = r_iter->action;
+		r_img.syscall = r_iter->syscall;
+		r_img.strict = r_iter->strict;
+		r_img.arg_cnt = _db_rule_arg_cnt(r_iter);
+		_db_img_write(buf, off, &r_img, sizeof(r_img));
+		for (iter_a = 0; iter_a < ARG_COUNT_MAX; iter_a++) {
+			if (!r_iter->args[iter_a].valid)
+				continue;
+			memset(&a_img, 0, sizeof(a_img));
+			a_img.mask = r_iter->args[iter_a].mask;
+			a_img.datum = r_iter->args[iter_a].datum;
+			a_img.arg = iter_a;
+			a_img.op = r_iter->args[iter_a].op;
+			_db_img_write(buf, off, &a_img, sizeof(a_img));
+		}
+		r_iter = r_iter->next;
+	}
+}
+
+/**
+ * Export a filter collection as a filter DB image
+ * @param col the seccomp filter collection
+ * @param buf the image buffer, may be NULL
+ * @param len the image buffer length
+ *
+ * This function serializes the filter collection's attributes along with the
+ * syscall lists, argument chain trees and rule lists of each architecture
+ * filter into a binary image which can be loaded by db_col_import().  The
+ * image is a header, the attributes, and then for each filter a filter record
+ * followed by arrays of fixed size syscall and tree node records and the rule
+ * records, each of which is followed by its argument comparisons.  Tree nodes
+ * refer to each other by their index in the filter's node array, and all
+ * values are stored in host byte order.  If @buf is NULL, or @len is too
+ * small, the required length is returned in @len.  Returns zero on success,
+ * negative values on failure.
+ *
+ */
+int db_col_export(const struct db_filter_col *col, void *buf, size_t *len)
+{
+	int rc = 0;
+	unsigned int iter;
+	size_t size, off = 0;
+	struct db_img_hdr hdr;
+	struct db_img_attr attr;
+	struct db_img_map *maps;
+	struct db_sys_list *s_iter;
+	const struct db_filter *db;
+
+	maps = zmalloc(sizeof(*maps) * col->filter_cnt);
+	if (maps == NULL)
+		return -ENOMEM;
+
+	/* determine the image size */
+	size = sizeof(hdr) + sizeof(attr) * _DB_IMG_ATTR_CNT;
+	for (iter = 0; iter < col->filter_cnt; iter++) {
+		db = col->filters[iter];
+		rc = _db_img_map_build(&maps[iter], db);
+		if (rc < 0)
+			goto export_out;
+		size += sizeof(struct db_img_filter);
+		db_list_foreach(s_iter, db->syscalls)
+			size += sizeof(struct db_img_sys);
+		size += sizeof(struct db_img_node) * maps[iter].node_cnt;
+		_db_rule_cnt(db, &size);
+	}
+	if (size > UINT32_MAX) {
+		rc = -EFAULT;
+		goto export_out;
+	}
+	if (buf == NULL || *len < size)
+		goto export_out;
+
+	/* write the image */
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = _DB_IMG_MAGIC;
+	hdr.version = _DB_IMG_VERSION;
+	hdr.size = size;
+	hdr.flags = (col->notify_used ? _DB_IMG_F_NOTIFY : 0);
+	hdr.attr_cnt = _DB_IMG_ATTR_CNT;
+	hdr.filter_cnt = col->filter_cnt;
+	_db_img_write(buf, &off, &hdr, sizeof(hdr));
+	for (iter = 0; iter < _DB_IMG_ATTR_CNT; iter++) {
+		attr.attr = _db_img_attrs[iter];
+		attr.value = db_col_attr_read(col, _db_img_attrs[iter]);
+		_db_img_write(buf, &off, &attr, sizeof(attr));
+	}
+	for (iter = 0; iter < col->filter_cnt; iter++)
+		_db_img_filter_write(col->filters[iter], &maps[iter],
+				     buf, &off);
+
+export_out:
+	if (rc == 0 && (buf != NULL && *len < size))
+		rc = -ERANGE;
+	if (rc == 0 || rc == -ERANGE)
+		*len = size;
+	for (iter = 0; iter < col->filter_cnt; iter++) {
+		zfree(maps[iter].nodes);
+		zfree(maps[iter].slots);
+	}
+	zfree(maps);
+	return rc;
+}
+
+/**
+ * Check a level of a filter image argument chain tree
+ * @param nodes the image node records
+ * @param lvl_prv the previous node on each node's level
+ * @param state the node states
+ * @param node_cnt the number of nodes
+ * @param idx the image index of a node on the level, or _DB_IMG_NONE
+ * @param depth the depth of the level in the tree
+ *
+ * This is a helper function for db_col_import(), it verifies that the tree
+ * rooted at the given level is acyclic and no deeper than any argument chain
+ * we would build ourselves, marking each node it finds.  Returns zero on
+ * success, -EINVAL if the tree is invalid.
+ *
+ */
+static int _db_img_level_check(const struct db_img_node *nodes,
+			       const uint32_t *lvl_prv, uint8_t *state,
+			       unsigned int node_cnt,
+			       uint32_t idx, unsigned int depth)
+{
+	int rc;
+	unsigned int cnt = 0;
+	uint32_t iter;
+
+	if (idx == _DB_IMG_NONE)
+		return 0;
+	if (depth >= _DB_IMG_DEPTH_MAX)
+		return -EINVAL;
+
+	/* levels are identified by their first node */
+	while (lvl_prv[idx] != _DB_IMG_NONE) {
+		idx = lvl_prv[idx];
+		if (++cnt > node_cnt)
+			return -EINVAL;
+	}
+	if (state[idx] & _DB_IMG_ST_DONE)
+		return 0;
+	if (state[idx] & _DB_IMG_ST_BUSY)
+		return -EINVAL;
+
+	state[idx] |= _DB_IMG_ST_BUSY;
+	for (iter = idx; iter != _DB_IMG_NONE; iter = nodes[iter].lvl_nxt) {
+		state[iter] |= _DB_IMG_ST_SEEN;
+		rc = _db_img_level_check(nodes, lvl_prv, state, node_cnt,
+					 nodes[iter].nxt_t, depth + 1);
+		if (rc == 0)
+			rc = _db_img_level_check(nodes, lvl_prv, state,
+						 node_cnt,
+						 nodes[iter].nxt_f, depth + 1);
+		if (rc < 0)
+			return rc;
+	}
+	state[idx] &= ~_DB_IMG_ST_BUSY;
+	state[idx] |= _DB_IMG_ST_DONE;
+
+	return 0;
+}
+
+/**
+ * Check a filter image tree node
+ * @param arch the filter's architecture
+ * @param n_img the node record
+ * @param node_cnt the number of nodes
+ *
+ * Returns zero if the node record is valid, -EINVAL otherwise.
+ *
+ */
+static int _db_img_node_check(const struct arch_def *arch,
+			      const struct db_img_node *n_img,
+			      unsigned int node_cnt)
+{
+	int offset = n_img->arg_offset;
+
+	if (n_img->arg >= ARG_COUNT_MAX ||
+	    (offset != arch_arg_offset_lo(arch, n_img->arg) &&
+	     offset != arch_arg_offset_hi(arch, n_img->arg)))
+		return -EINVAL;
+	if (n_img->op <= _SCMP_CMP_MIN || n_img->op >= _SCMP_CMP_MAX ||
+	    n_img->op_orig <= _SCMP_CMP_MIN || n_img->op_orig >= _SCMP_CMP_MAX)
+		return -EINVAL;
+	if (n_img->arg_h_flg > 1 || n_img->act_t_flg > 1 ||
+	    n_img->act_f_flg > 1)
+		return -EINVAL;
+	if ((n_img->act_t_flg && db_col_action_valid(NULL, n_img->act_t)) ||
+	    (n_img->act_f_flg && db_col_action_valid(NULL, n_img->act_f)))
+		return -EINVAL;
+	if ((n_img->lvl_nxt != _DB_IMG_NONE && n_img->lvl_nxt >= node_cnt) ||
+	    (n_img->nxt_t != _DB_IMG_NONE && n_img->nxt_t >= node_cnt) ||
+	    (n_img->nxt_f != _DB_IMG_NONE && n_img->nxt_f >= node_cnt))
+		return -EINVAL;
+
+	return 0;
+}
+
+/**
+ * Read a single filter from a filter image
+ * @param buf the image buffer
+ * @param len the image length
+ * @param off the filter offset, updated on return
+ * @param filter the new filter
+ *
+ * This is a helper function for db_col_import(), it verifies the filter's
+ * records and rebuilds the filter's syscall list, argument chain trees and
+ * rule list directly from them.  Returns zero on success, negative values on
+ * failure.
+ *
+ */
+static int _db_img_filter_read(const void *buf, size_t len, size_t *off,
+			       struct db_filter **filter)
+{
+	int rc = 0;
+	unsigned int iter, iter_a;
+	uint32_t idx, num_prev = 0;
+	size_t s_off;
+	bool attached = false;
+	const struct arch_def *arch;
+	struct db_img_filter f_img;
+	struct db_img_sys s_img;
+	struct db_img_rule r_img;
+	struct db_img_arg a_img;
+	struct db_img_node *n_img = NULL;
+	uint32_t *lvl_prv = NULL;
+	unsigned int *refcnt = NULL;
+	uint8_t *state = NULL;
+	struct db_arg_chain_tree **nodes = NULL;
+	struct db_arg_chain_tree *node;
+	struct db_sys_list *s_new, **s_tail;
+	struct db_api_rule_list *rule;
+	struct db_filter *db = NULL;
+
+	rc = _db_img_read(buf, len, off, &f_img, sizeof(f_img));
+	if (rc < 0)
+		return rc;
+	arch = arch_def_lookup(f_img.arch);
+	if (arch == NULL || f_img.syscall_cnt > f_img.sys_cnt)
+		return -EINVAL;
+	if ((uint64_t)f_img.sys_cnt * sizeof(s_img) +
+	    (uint64_t)f_img.node_cnt * sizeof(*n_img) +
+	    (uint64_t)f_img.rule_cnt * sizeof(r_img) > len - *off)
+		return -EINVAL;
+	s_off = *off;
+	*off += sizeof(s_img) * f_img.sys_cnt;
+
+	/* verify the tree nodes and work out their reference counts */
+	if (f_img.node_cnt > 0) {
+		n_img = zmalloc(sizeof(*n_img) * f_img.node_cnt);
+		lvl_prv = zmalloc(sizeof(*lvl_prv) * f_img.node_cnt);
+		refcnt = zmalloc(sizeof(*refcnt) * f_img.node_cnt);
+		state = zmalloc(sizeof(*state) * f_img.node_cnt);
+		nodes = zmalloc(sizeof(*nodes) * f_img.node_cnt);
+		if (n_img == NULL || lvl_prv == NULL || refcnt == NULL ||
+		    state == NULL || nodes == NULL) {
+			rc = -ENOMEM;
+			goto read_out;
+		}
+		_db_img_read(buf, len, off,
+			     n_img, sizeof(*n_img) * f_img.node_cnt);
+		memset(lvl_prv, 0xff, sizeof(*lvl_prv) * f_img.node_cnt);
+	}
+	for (iter = 0; iter < f_img.node_cnt; iter++) {
+		rc = _db_img_node_check(arch, &n_img[iter], f_img.node_cnt);
+		if (rc < 0)
+			goto read_out;
+		idx = n_img[iter].lvl_nxt;
+		if (idx != _DB_IMG_NONE) {
+			if (idx == iter || lvl_prv[idx] != _DB_IMG_NONE) {
+				rc = -EINVAL;
+				goto read_out;
+			}
+			lvl_prv[idx] = iter;
+			refcnt[idx]++;
+			refcnt[iter]++;
+		}
+		if (n_img[iter].nxt_t != _DB_IMG_NONE)
+			refcnt[n_img[iter].nxt_t]++;
+		if (n_img[iter].nxt_f != _DB_IMG_NONE)
+			refcnt[n_img[iter].nxt_f]++;
+	}
+
+	/* verify the syscall list and the shape of the trees */
+	for (iter = 0; iter < f_img.sys_cnt; iter++) {
+		_db_img_read(buf, len, &s_off, &s_img, sizeof(s_img));
+		idx = s_img.chains;
+		if ((iter > 0 && s_img.num <= num_prev) || s_img.valid > 1 ||
+		    (idx != _DB_IMG_NONE &&
+		     (idx >= f_img.node_cnt || !s_img.valid)) ||
+		    (idx == _DB_IMG_NONE && s_img.valid &&
+		     db_col_action_valid(NULL, s_img.action) < 0)) {
+			rc = -EINVAL;
+			goto read_out;
+		}
+		num_prev = s_img.num;
+		if (idx == _DB_IMG_NONE)
+			continue;
+		refcnt[idx]++;
+		rc = _db_img_level_check(n_img, lvl_prv, state,
+					 f_img.node_cnt, idx, 0);
+		if (rc < 0)
+			goto read_out;
+	}
+	for (iter = 0; iter < f_img.node_cnt; iter++) {
+		if (!(state[iter] & _DB_IMG_ST_SEEN)) {
+			rc = -EINVAL;
+			goto read_out;
+		}
+	}
+	s_off -= sizeof(s_img) * f_img.sys_cnt;
+
+	/* do all of the allocations before we start linking the trees */
+	db = _db_init(arch);
+	if (db == NULL) {
+		rc = -ENOMEM;
+		goto read_out;
+	}
+	for (iter = 0; iter < f_img.node_cnt; iter++) {
+		nodes[iter] = zmalloc(sizeof(*nodes[iter]));
+		if (nodes[iter] == NULL) {
+			rc = -ENOMEM;
+			goto read_out;
+		}
+	}
+	s_tail = &db->syscalls;
+	for (iter = 0; iter < f_img.sys_cnt; iter++) {
+		s_new = zmalloc(sizeof(*s_new));
+		if (s_new == NULL) {
+			rc = -ENOMEM;
+			goto read_out;
+		}
+		*s_tail = s_new;
+		s_tail = &s_new->next;
+	}
+	db->syscall_cnt = f_img.syscall_cnt;
+
+	/* rebuild the syscall list and the trees */
+	for (iter = 0; iter < f_img.node_cnt; iter++) {
+		node = nodes[iter];
+		node->arg = n_img[iter].arg;
+		node->arg_h_flg = n_img[iter].arg_h_flg;
+		node->arg_offset = n_img[iter].arg_offset;
+		node->op = n_img[iter].op;
+		node->op_orig = n_img[iter].op_orig;
+		node->mask = n_img[iter].mask;
+		node->datum = n_img[iter].datum;
+		node->datum_full = n_img[iter].datum_full;
+		node->act_t_flg = n_img[iter].act_t_flg;
+		node->act_f_flg = n_img[iter].act_f_flg;
+		node->act_t = n_img[iter].act_t;
+		node->act_f = n_img[iter].act_f;
+		if (lvl_prv[iter] != _DB_IMG_NONE)
+			node->lvl_prv = nodes[lvl_prv[iter]];
+		if (n_img[iter].lvl_nxt != _DB_IMG_NONE)
+			node->lvl_nxt = nodes[n_img[iter].lvl_nxt];
+		if (n_img[iter].nxt_t != _DB_IMG_NONE)
+			node->nxt_t = nodes[n_img[iter].nxt_t];
+		if (n_img[iter].nxt_f != _DB_IMG_NONE)
+			node->nxt_f = nodes[n_img[iter].nxt_f];
+		node->refcnt = refcnt[iter];
+	}
+	db_list_foreach(s_new, db->syscalls) {
+		_db_img_read(buf, len, &s_off, &s_img, sizeof(s_img));
+		s_new->num = s_img.num;
+		s_new->priority = s_img.priority;
+		s_new->action = s_img.action;
+		s_new->node_cnt = s_img.node_cnt;
+		if (s_img.chains != _DB_IMG_NONE)
+			s_new->chains = nodes[s_img.chains];
+		s_new->valid = s_img.valid;
+		s_new->weight = s_img.weight;
+	}
+	attached = true;
+
+	/* rebuild the rule list */
+	for (iter = 0; iter < f_img.rule_cnt; iter++) {
+		rc = _db_img_read(buf, len, off, &r_img, sizeof(r_img));
+		if (rc == 0 &&
+		    (r_img.strict > 1 || r_img.arg_cnt > ARG_COUNT_MAX ||
+		     db_col_action_valid(NULL, r_img.action) < 0))
+			rc = -EINVAL;
+		if (rc < 0)
+			goto read_out;
+		rule = zmalloc(sizeof(*rule));
+		if (rule == NULL) {
+			rc = -ENOMEM;
+			goto read_out;
+		}
+		rule->action = r_img.action;
+		rule->syscall = r_img.syscall;
+		rule->strict = r_img.strict;
+		_db_col_rule_link(db, rule);
+		for (iter_a = 0; iter_a < r_img.arg_cnt; iter_a++) {
+			rc = _db_img_read(buf, len, off, &a_img, sizeof(a_img));
+			if (rc == 0 &&
+			    (a_img.arg >= ARG_COUNT_MAX ||
+			     rule->args[a_img.arg].valid ||
+			     a_img.op <= _SCMP_CMP_MIN ||
+			     a_img.op >= _SCMP_CMP_MAX))
+				rc = -EINVAL;
+			if (rc < 0)
+				goto read_out;
+			rule->args[a_img.arg].arg = a_img.arg;
+			rule->args[a_img.arg].op = a_img.op;
+			rule->args[a_img.arg].mask = a_img.mask;
+			rule->args[a_img.arg].datum = a_img.datum;
+			rule->args[a_img.arg].valid = true;
+		}
+	}
+
+	*filter = db;
+	db = NULL;
+
+read_out:
+	if (db != NULL) {
+		/* until the trees are attached the filter doesn't own the
+		 * nodes */
+		for (iter = 0; !attached && iter < f_img.node_cnt; iter++)
+			zfree(nodes[iter]);
+		_db_release(db);
+	}
+	zfree(nodes);
+	zfree(state);
+	zfree(refcnt);
+	zfree(lvl_prv);
+	zfree(n_img);
+	return rc;
+}
+
+/**
+ * Import a filter DB image into a filter collection
+ * @param col the seccomp filter collection
+ * @param buf the image buffer
+ * @param len the image buffer length
+ *
+ * This function replaces the architecture filters, rules and attributes of the
+ * filter collection with those in a filter DB image created by
+ * db_col_export().  The filters are rebuilt directly from the image without
+ * resolving any syscalls or adding any rules.  Any pending transactions are
+ * discarded.  On failure the filter collection is left unchanged.  Returns
+ * zero on success, negative values on failure.
+ *
+ */
+int db_col_import(struct db_filter_col *col, const void *buf, size_t len)
+{
+	int rc = 0;
+	unsigned int iter, iter_b;
+	int endian = 0;
+	size_t off = 0, attr_off;
+	uint32_t act_default;
+	bool notify_old;
+	struct db_img_hdr hdr;
+	struct db_img_attr attr;
+	struct db_filter_attr attr_old;
+	struct db_filter **filters;
+	struct db_filter_snap *snap;
+
+	rc = _db_img_read(buf, len, &off, &hdr, sizeof(hdr));
+	if (rc < 0)
+		return rc;
+	if (hdr.magic != _DB_IMG_MAGIC || hdr.version != _DB_IMG_VERSION ||
+	    hdr.size < sizeof(hdr) || hdr.size > len ||
+	    (hdr.flags & ~_DB_IMG_F_NOTIFY) || hdr.filter_cnt == 0)
+		return -EINVAL;
+	len = hdr.size;
+	if (hdr.attr_cnt > (len - off) / sizeof(attr) ||
+	    hdr.filter_cnt > (len - off) / sizeof(struct db_img_filter))
+		return -EINVAL;
+
+	/* verify the attributes, we apply them once the filters are built */
+	attr_off = off;
+	for (iter = 0; iter < hdr.attr_cnt; iter++) {
+		_db_img_read(buf, len, &off, &attr, sizeof(attr));
+		for (iter_b = 0; iter_b < _DB_IMG_ATTR_CNT; iter_b++) {
+			if (_db_img_attrs[iter_b] == attr.attr)
+				break;
+		}
+		if (iter_b == _DB_IMG_ATTR_CNT)
+			return -EINVAL;
+	}
+
+	/* build the new filters */
+	filters = zmalloc(sizeof(*filters) * hdr.filter_cnt);
+	if (filters == NULL)
+		return -ENOMEM;
+	for (iter = 0; iter < hdr.filter_cnt; iter++) {
+		rc = _db_img_filter_read(buf, len, &off, &filters[iter]);
+		if (rc < 0)
+			goto import_failure;
+		for (iter_b = 0; iter_b < iter; iter_b++) {
+			if (filters[iter_b]->arch->token ==
+			    filters[iter]->arch->token)
+				rc = -EINVAL;
+		}
+		if (endian != 0 && endian != filters[iter]->arch->endian)
+			rc = -EINVAL;
+		if (rc < 0)
+			goto import_failure;
+		endian = filters[iter]->arch->endian;
+	}
+	if (off != len) {
+		rc = -EINVAL;
+		goto import_failure;
+	}
+
+	/* apply the attributes */
+	attr_old = col->attr;
+	notify_old = col->notify_used;
+	col->notify_used = (hdr.flags & _DB_IMG_F_NOTIFY);
+	act_default = col->attr.act_default;
+	for (iter = 0; iter < hdr.attr_cnt; iter++) {
+		_db_img_read(buf, len, &attr_off, &attr, sizeof(attr));
+		if (attr.attr == SCMP_FLTATR_ACT_DEFAULT)
+			act_default = attr.value;
+		else if (attr.value != db_col_attr_read(col, attr.attr)) {
+			rc = db_col_attr_set(col, attr.attr, attr.value);
+			if (rc < 0)
+				goto import_restore;
+		}
+	}
+	rc = db_col_action_valid(col, act_default);
+	if (rc < 0)
+		goto import_restore;
+	col->attr.act_default = act_default;
+
+	/* replace the filters */
+	while (col->snapshots != NULL) {
+		snap = col->snapshots;
+		col->snapshots = snap->next;
+		_db_snap_release(snap);
+	}
+	for (iter = 0; iter < col->filter_cnt; iter++)
+		_db_release(col->filters[iter]);
+	zfree(col->filters);
+	col->filters = filters;
+	col->filter_cnt = hdr.filter_cnt;
+	col->endian = endian;
+	db_col_precompute_reset(col);
+
+	return 0;
+
+import_restore:
+	col->attr = attr_old;
+	col->notify_used = notify_old;
+import_failure:
+	for (iter = 0; iter < hdr.filter_cnt; iter++)
+		_db_release(filters[iter]);
+	zfree(filters);
+	return rc;
 }
@@ -30,6 +30,7 @@
 
 #include "arch.h"
 #include "gen_bpf.h"
+#include "helper.h"
 
 /* XXX - need to provide doxygen comments for the types here */
 
@@ -90,6 +91,8 @@ struct db_sys_list {
 
 	/* priority - higher is better */
 	unsigned int priority;
+	/* relative hit frequency, used by SCMP_FLTATR_CTL_OPTIMIZE level 3 */
+	uint32_t weight;
 
 	/* the argument chain heads */
 	struct db_arg_chain_tree *chains;
@@ -126,6 +129,21 @@ struct db_filter_attr {
 	uint32_t api_sysrawrc;
 	/* request SECCOMP_FILTER_FLAG_WAIT_KILLABLE_RECV */
 	uint32_t wait_killable_recv;
+	/* SCMP_FLTATR_CTL_MINIMIZE related attributes */
+	uint32_t minimize;
+	/* SCMP_FLTATR_CTL_CACHE related attributes */
+	uint32_t cache_enable;
+};
+
+struct db_filter_stats {
+	/* tests removed from the precomputed program */
+	uint32_t min_nodes;
+	/* instructions removed from the precomputed program */
+	uint32_t min_insns;
+	/* expected syscall cost, in hundredths of an instruction, with the
+	 * default ordering and with the weighted ordering */
+	uint32_t cost_before;
+	uint32_t cost_after;
 };
 
 struct db_filter {
@@ -149,6 +167,8 @@ struct db_filter_snap {
 	struct db_filter_snap *next;
 };
 
+struct db_prgm_cache;
+
 struct db_filter_col {
 	/* verification / state */
 	int state;
@@ -169,6 +189,12 @@ struct db_filter_col {
 
 	/* precomputed programs */
 	struct bpf_program *prgm_bpf;
+	struct db_filter_stats prgm_stats;
+	/* shared program cache entry, if prgm_bpf came from the cache */
+	struct db_prgm_cache *prgm_cache;
+
+	/* memory accounting */
+	struct mem_acct mem;
 };
 
 /**
@@ -195,6 +221,9 @@ int db_col_action_valid(const struct db_filter_col *col, uint32_t action);
 
 int db_col_merge(struct db_filter_col *col_dst, struct db_filter_col *col_src);
 
+int db_col_export(const struct db_filter_col *col, void *buf, size_t *len);
+int db_col_import(struct db_filter_col *col, const void *buf, size_t len);
+
 int db_col_arch_exist(struct db_filter_col *col, uint32_t arch_token);
 
 int db_col_attr_get(const struct db_filter_col *col,
@@ -211,9 +240,13 @@ int db_col_db_remove(struct db_filter_col *col, uint32_t arch_token);
 int db_col_rule_add(struct db_filter_col *col,
 		    bool strict, uint32_t action, int syscall,
 		    unsigned int arg_cnt, const struct scmp_arg_cmp *arg_array);
+int db_col_rule_add_batch(struct db_filter_col *col,
+			  const struct scmp_rule *rules, unsigned int rule_cnt);
 
 int db_col_syscall_priority(struct db_filter_col *col,
 			    int syscall, uint8_t priority);
+int db_col_syscall_weight(struct db_filter_col *col,
+			  int syscall, uint32_t weight);
 
 int db_col_transaction_start(struct db_filter_col *col);
 void db_col_transaction_abort(struct db_filter_col *col);
@@ -51,6 +51,10 @@
 #define BTREE_HSH_INVALID		(UINT64_MAX)
 #define BTREE_SYSCALL_INVALID		(UINT_MAX)
 
+/* value dispatch definitions */
+#define DISPATCH_MIN			(4)
+#define DISPATCH_PER_LEAF		(2)
+
 struct acc_state {
 	int32_t offset;
 	uint32_t mask;
@@ -128,6 +132,9 @@ struct bpf_blk {
 	/* priority - higher is better */
 	unsigned int priority;
 
+	/* worst case instruction count from here, zero if not yet known */
+	unsigned int cost;
+
 	/* status flags */
 	bool flag_hash;			/* added to the hash table */
 	bool flag_dup;			/* duplicate block and in use */
@@ -141,6 +148,9 @@ struct bpf_blk {
 	struct bpf_blk *hash_nxt;
 	struct bpf_blk *prev, *next;
 	struct bpf_blk *lvl_prv, *lvl_nxt;
+
+	/* list of all the blocks owned by the BPF state */
+	struct bpf_blk *own_prv, *own_nxt;
 };
 #define _BLK_MSZE(x) \
 	((x)->blk_cnt * sizeof(*((x)->blks)))
@@ -157,6 +167,8 @@ struct bpf_hash_bkt {
 struct bpf_state {
 	/* block hash table */
 	struct bpf_hash_bkt *htbl[_BPF_HASH_SIZE];
+	/* all of the allocated instruction blocks */
+	struct bpf_blk *b_own;
 
 	/* filter attributes */
 	const struct db_filter_attr *attr;
@@ -168,13 +180,58 @@ struct bpf_state {
 	/* bpf program */
 	struct bpf_program *bpf;
 
+	/* expected cost accounting for SCMP_FLTATR_CTL_OPTIMIZE level 3, the
+	 * sums are of the syscall weight multiplied by the instruction count */
+	uint64_t cost_weight;
+	uint64_t cost_before;
+	uint64_t cost_after;
+
 	/* WARNING - the following variables are temporary use only */
 	const struct arch_def *arch;
+	uint32_t sys_min;
+	uint32_t sys_max;
 	struct bpf_blk *b_head;
 	struct bpf_blk *b_tail;
 	struct bpf_blk *b_new;
 };
 
+#define MIN_DATA_WORDS \
+	(sizeof(struct seccomp_data) / sizeof(uint32_t))
+
+/* decoded instruction used by the minimization pass */
+struct min_instr {
+	uint16_t code;
+	uint32_t k;
+	/* absolute instruction indices of the jump targets */
+	unsigned int jt;
+	unsigned int jf;
+};
+
+/* per-instruction results of the minimization analysis */
+struct min_info {
+	bool reach;
+	bool dead;
+	/* accumulator state on entry */
+	struct acc_state acc;
+	/* registers which are live on entry and exit */
+	bool live_a;
+	bool live_x;
+	bool live_a_out;
+	bool live_x_out;
+};
+
+/* what is known about the filter input on a given path */
+struct min_facts {
+	/* the outcome of the last test */
+	bool test;
+	uint16_t op;
+	uint32_t k;
+	bool res;
+	/* known bits of the seccomp_data words */
+	uint32_t k_mask[MIN_DATA_WORDS];
+	uint32_t k_val[MIN_DATA_WORDS];
+};
+
 /**
  * Populate a BPF instruction
  * @param _ins the BPF instruction
@@ -253,12 +310,21 @@ static void __blk_free(struct bpf_state *state, struct bpf_blk *blk)
 	while (blk->hash_nxt != NULL) {
 		b_tmp = blk->hash_nxt;
 		blk->hash_nxt = b_tmp->hash_nxt;
+		b_tmp->hash_nxt = NULL;
 		if (!b_tmp->flag_dup)
-			free(b_tmp);
+			__blk_free(state, b_tmp);
 	}
 	if (blk->blks != NULL && blk->flag_unique)
-		free(blk->blks);
-	free(blk);
+		zfree(blk->blks);
+
+	/* drop the block from the state's ownership list */
+	if (blk->own_prv != NULL)
+		blk->own_prv->own_nxt = blk->own_nxt;
+	else
+		state->b_own = blk->own_nxt;
+	if (blk->own_nxt != NULL)
+		blk->own_nxt->own_prv = blk->own_prv;
+	zfree(blk);
 }
 
 /**
@@ -315,12 +381,15 @@ static void _blk_free(struct bpf_state *state, struct bpf_blk *blk)
 
 /**
  * Allocate and initialize a new instruction block
+ * @param state the BPF state
  *
  * Allocate a new BPF instruction block and perform some very basic
- * initialization.  Returns a pointer to the block on success, NULL on failure.
+ * initialization.  The block is owned by the BPF state until it is freed, so
+ * any blocks left behind by a failed build are released by _state_release().
+ * Returns a pointer to the block on success, NULL on failure.
  *
  */
-static struct bpf_blk *_blk_alloc(void)
+static struct bpf_blk *_blk_alloc(struct bpf_state *state)
 {
 	struct bpf_blk *blk;
 
@@ -331,6 +400,11 @@ static struct bpf_blk *_blk_alloc(void)
 	blk->acc_start = _ACC_STATE_UNDEF;
 	blk->acc_end = _ACC_STATE_UNDEF;
 
+	blk->own_nxt = state->b_own;
+	if (state->b_own != NULL)
+		state->b_own->own_prv = blk;
+	state->b_own = blk;
+
 	return blk;
 }
 
@@ -363,10 +437,8 @@ static struct bpf_blk *_blk_resize(struct bpf_state *state,
 	blk->blk_alloc += size_adj;
 	new_size = blk->blk_alloc * sizeof(*new);
 	new = zrealloc(blk->blks, old_size, new_size);
-	if (new == NULL) {
-		_blk_free(state, blk);
+	if (new == NULL)
 		return NULL;
-	}
 	blk->blks = new;
 
 	return blk;
@@ -380,8 +452,7 @@ static struct bpf_blk *_blk_resize(struct bpf_state *state,
  *
  * Add the new BPF instruction to the end of the given instruction block.  If
  * the given instruction block is NULL, a new block will be allocated.  Returns
- * a pointer to the block on success, NULL on failure, and in the case of
- * failure the instruction block is free'd.
+ * a pointer to the block on success, NULL on failure.
  *
  */
 static struct bpf_blk *_blk_append(struct bpf_state *state,
@@ -389,7 +460,7 @@ static struct bpf_blk *_blk_append(struct bpf_state *state,
 				   const struct bpf_instr *instr)
 {
 	if (blk == NULL) {
-		blk = _blk_alloc();
+		blk = _blk_alloc(state);
 		if (blk == NULL)
 			return NULL;
 	}
@@ -409,8 +480,7 @@ static struct bpf_blk *_blk_append(struct bpf_state *state,
  *
  * Add the new BPF instruction to the start of the given instruction block.
  * If the given instruction block is NULL, a new block will be allocated.
- * Returns a pointer to the block on success, NULL on failure, and in the case
- * of failure the instruction block is free'd.
+ * Returns a pointer to the block on success, NULL on failure.
  *
  */
 static struct bpf_blk *_blk_prepend(struct bpf_state *state,
@@ -505,7 +575,7 @@ static int _bpf_append_blk(struct bpf_program *prg, const struct bpf_blk *blk)
 
 bpf_append_blk_failure:
 	prg->blk_cnt = 0;
-	free(prg->blks);
+	zfree(prg->blks);
 	return rc;
 }
 
@@ -523,8 +593,8 @@ static void _program_free(struct bpf_program *prg)
 		return;
 
 	if (prg->blks != NULL)
-		free(prg->blks);
-	free(prg);
+		zfree(prg->blks);
+	zfree(prg);
 }
 
 /**
@@ -538,6 +608,7 @@ static void _state_release(struct bpf_state *state)
 {
 	unsigned int bkt;
 	struct bpf_hash_bkt *iter;
+	struct bpf_blk *blk;
 
 	if (state == NULL)
 		return;
@@ -547,10 +618,17 @@ static void _state_release(struct bpf_state *state)
 		while (state->htbl[bkt]) {
 			iter = state->htbl[bkt];
 			state->htbl[bkt] = iter->next;
-			__blk_free(state, iter->blk);
-			free(iter);
+			zfree(iter);
 		}
 	}
+
+	/* release any instruction blocks that are still around, duplicates
+	 * are on the ownership list so we don't chase the hash chains */
+	while (state->b_own != NULL) {
+		blk = state->b_own;
+		blk->hash_nxt = NULL;
+		__blk_free(state, blk);
+	}
 	_program_free(state->bpf);
 
 	memset(state, 0, sizeof(*state));
@@ -608,7 +686,7 @@ hsh_add_restart:
 			    _ACC_CMP_EQ(h_iter->blk->acc_end,
 					blk->acc_end)) {
 				/* duplicate block */
-				free(h_new);
+				zfree(h_new);
 
 				/* store the duplicate block */
 				b_iter = h_iter->blk;
@@ -628,7 +706,7 @@ hsh_add_restart:
 					h_iter->blk->priority = blk->priority;
 
 				/* try to save some memory */
-				free(blk->blks);
+				zfree(blk->blks);
 				blk->blks = h_iter->blk->blks;
 				blk->flag_unique = false;
 
@@ -640,7 +718,7 @@ hsh_add_restart:
 					/* overflow */
 					blk->flag_hash = false;
 					blk->hash = 0;
-					free(h_new);
+					zfree(h_new);
 					return -EFAULT;
 				}
 				h_val += ((uint64_t)1 << 32);
@@ -684,7 +762,7 @@ static struct bpf_blk *_hsh_remove(struct bpf_state *state, uint64_t h_val)
 			else
 				state->htbl[bkt] = h_iter->next;
 			blk = h_iter->blk;
-			free(h_iter);
+			zfree(h_iter);
 			return blk;
 		}
 		h_prev = h_iter;
@@ -761,6 +839,47 @@ static struct bpf_blk *_hsh_find(const struct bpf_state *state, uint64_t h_val)
 	return h_iter->blk;
 }
 
+/**
+ * Find the worst case cost of an instruction block
+ * @param state the BPF state
+ * @param blk the BPF instruction block
+ *
+ * Return the number of instructions executed on the longest path from the
+ * start of the given block to the end of the filter, following the block hash
+ * table jump targets.  The result is saved in the block so that blocks which
+ * are shared between paths are only visited once.
+ *
+ */
+static unsigned int _blk_cost(const struct bpf_state *state,
+			      struct bpf_blk *blk)
+{
+	unsigned int iter, cost, cost_max = 0;
+	struct bpf_instr *i_iter;
+	struct bpf_blk *b_iter;
+
+	if (blk->cost > 0)
+		return blk->cost;
+
+	for (iter = 0; iter < blk->blk_cnt; iter++) {
+		i_iter = &blk->blks[iter];
+		if (i_iter->jt.type == TGT_PTR_HSH) {
+			b_iter = _hsh_find(state, i_iter->jt.tgt.hash);
+			cost = (b_iter != NULL ? _blk_cost(state, b_iter) : 0);
+			if (cost > cost_max)
+				cost_max = cost;
+		}
+		if (i_iter->jf.type == TGT_PTR_HSH) {
+			b_iter = _hsh_find(state, i_iter->jf.tgt.hash);
+			cost = (b_iter != NULL ? _blk_cost(state, b_iter) : 0);
+			if (cost > cost_max)
+				cost_max = cost;
+		}
+	}
+	blk->cost = blk->blk_cnt + cost_max;
+
+	return blk->cost;
+}
+
 /**
  * Generate a BPF action instruction
  * @param state the BPF state
@@ -799,10 +918,8 @@ static struct bpf_blk *_gen_bpf_action_hsh(struct bpf_state *state,
 	blk = _gen_bpf_action(state, NULL, action);
 	if (blk == NULL)
 		return NULL;
-	if (_hsh_add(state, &blk, 0) < 0) {
-		_blk_free(state, blk);
+	if (_hsh_add(state, &blk, 0) < 0)
 		return NULL;
-	}
 
 	return blk;
 }
@@ -827,7 +944,7 @@ static struct bpf_blk *_gen_bpf_node(struct bpf_state *state,
 	struct bpf_blk *blk, *b_act;
 	struct bpf_instr instr;
 
-	blk = _blk_alloc();
+	blk = _blk_alloc(state);
 	if (blk == NULL)
 		return NULL;
 	blk->acc_start = *a_state;
@@ -930,7 +1047,7 @@ static struct bpf_blk *_gen_bpf_node(struct bpf_state *state,
 	return blk;
 
 node_failure:
-	_blk_free(state, blk);
+	/* NOTE: the partial block is released along with the BPF state */
 	return NULL;
 }
 
@@ -1036,6 +1153,241 @@ static struct bpf_blk *_gen_bpf_chain_lvl_res(struct bpf_state *state,
 	return blk;
 }
 
+/**
+ * Test if a chain level block can be part of a value dispatch
+ * @param blk the BPF instruction block
+ * @param b_prev the previous block in the run, or NULL
+ *
+ * Returns true if the given block is a simple equality test which falls
+ * through to the next block on the level when the test fails and, if @b_prev
+ * is given, compares the same accumulator value against a different datum.
+ *
+ */
+static bool _gen_bpf_dispatch_test(const struct bpf_blk *blk,
+				   const struct bpf_blk *b_prev)
+{
+	const struct db_arg_chain_tree *node = blk->node;
+
+	if (node == NULL)
+		return false;
+	if (node->op != SCMP_CMP_EQ && node->op != SCMP_CMP_MASKED_EQ)
+		return false;
+	if (node->nxt_f != NULL || node->act_f_flg)
+		return false;
+	if (b_prev == NULL)
+		return true;
+
+	/* we must be able to jump straight to the comparison */
+	if (blk->blk_cnt != 1 || !_ACC_CMP_EQ(blk->acc_start, b_prev->acc_end))
+		return false;
+	return (node->datum != b_prev->node->datum);
+}
+
+/**
+ * Compare two blocks in a value dispatch run by datum
+ * @param a the first block
+ * @param b the second block
+ *
+ * This is a qsort(3) comparison function which sorts the blocks in a run of
+ * equality tests from the smallest datum to the largest.
+ *
+ */
+static int _gen_bpf_dispatch_cmp(const void *a, const void *b)
+{
+	const struct bpf_blk *b_a = *(struct bpf_blk * const *)a;
+	const struct bpf_blk *b_b = *(struct bpf_blk * const *)b;
+
+	if (b_a->node->datum < b_b->node->datum)
+		return -1;
+	else if (b_a->node->datum > b_b->node->datum)
+		return 1;
+	return 0;
+}
+
+/**
+ * Generate a value dispatch tree for a run of equality tests
+ * @param state the BPF state
+ * @param run the blocks in the run, sorted by datum
+ * @param lo the first block in this branch of the tree
+ * @param hi the block after the last block in this branch of the tree
+ * @param jmp_exit the jump to take when no test in the run matches
+ * @param b_first the first block of the run on the level, NULL if not root
+ * @param b_head the head of the level
+ * @param b_anchor the block before the run on the level, or NULL
+ *
+ * Generate a binary search on the accumulator for the given run of equality
+ * tests, the leaves of the tree are short chains of the original blocks.  The
+ * new blocks are inserted into the level directly after @b_anchor.  Returns a
+ * pointer to the first block of the branch on success, NULL on failure.
+ *
+ */
+static struct bpf_blk *_gen_bpf_dispatch_tree(struct bpf_state *state,
+					      struct bpf_blk **run,
+					      unsigned int lo, unsigned int hi,
+					      const struct bpf_jump *jmp_exit,
+					      const struct bpf_blk *b_first,
+					      struct bpf_blk **b_head,
+					      struct bpf_blk *b_anchor)
+{
+	unsigned int iter, mid;
+	struct bpf_blk *blk, *b_t, *b_f;
+	struct bpf_instr instr;
+
+	if ((hi - lo) <= DISPATCH_PER_LEAF) {
+		/* chain the tests in the leaf, the last one exits the run */
+		for (iter = lo; iter < hi; iter++)
+			run[iter]->blks[run[iter]->blk_cnt - 1].jf =
+				(iter + 1 < hi ?
+				 _BPF_JMP_BLK(run[iter + 1]) : *jmp_exit);
+		return run[lo];
+	}
+
+	mid = lo + ((hi - lo) / 2);
+	b_t = _gen_bpf_dispatch_tree(state, run, mid, hi, jmp_exit, NULL,
+				     b_head, b_anchor);
+	if (b_t == NULL)
+		return NULL;
+	b_f = _gen_bpf_dispatch_tree(state, run, lo, mid, jmp_exit, NULL,
+				     b_head, b_anchor);
+	if (b_f == NULL)
+		return NULL;
+
+	blk = _blk_alloc(state);
+	if (blk == NULL)
+		return NULL;
+	blk->acc_start = run[0]->acc_end;
+	if (b_first != NULL) {
+		/* load the accumulator just as the first test would have */
+		blk->acc_start = b_first->acc_start;
+		for (iter = 0; iter < b_first->blk_cnt - 1; iter++) {
+			blk = _blk_append(state, blk, &b_first->blks[iter]);
+			if (blk == NULL)
+				return NULL;
+		}
+	}
+	blk->acc_end = run[0]->acc_end;
+	_BPF_INSTR(instr, _BPF_OP(state->arch, BPF_JMP + BPF_JGE),
+		   _BPF_JMP_BLK(b_t), _BPF_JMP_BLK(b_f),
+		   _BPF_K(state->arch, run[mid]->node->datum));
+	blk = _blk_append(state, blk, &instr);
+	if (blk == NULL)
+		return NULL;
+
+	/* insert the new block into the level */
+	if (b_anchor == NULL) {
+		blk->lvl_nxt = *b_head;
+		(*b_head)->lvl_prv = blk;
+		*b_head = blk;
+	} else {
+		blk->lvl_prv = b_anchor;
+		blk->lvl_nxt = b_anchor->lvl_nxt;
+		b_anchor->lvl_nxt->lvl_prv = blk;
+		b_anchor->lvl_nxt = blk;
+	}
+
+	return blk;
+}
+
+/**
+ * Lower runs of equality tests on a chain level into value dispatches
+ * @param state the BPF state
+ * @param b_head the head of the level
+ *
+ * Multiplexed syscalls such as socketcall(2) and ipc(2), as well as many
+ * ordinary filters, end up with long runs of equality tests against the same
+ * argument on a single level of the chain.  This function replaces any run of
+ * at least DISPATCH_MIN such tests with a binary search on the argument value
+ * so that the number of comparisons grows logarithmically with the length of
+ * the run instead of linearly.  This must be called after the TGT_NXT jumps
+ * on the level have been resolved.  Returns zero on success, negative values
+ * on failure.
+ *
+ */
+static int _gen_bpf_chain_dispatch(struct bpf_state *state,
+				   struct bpf_blk **b_head)
+{
+	int rc = 0;
+	unsigned int iter, run_cnt, run_max = 0;
+	struct bpf_blk **run = NULL, **run_new;
+	struct bpf_blk *b_iter, *b_anchor, *b_first, *b_root;
+	struct bpf_instr *i_iter;
+	struct bpf_jump jmp_exit;
+
+	b_iter = *b_head;
+	while (b_iter != NULL) {
+		if (!_gen_bpf_dispatch_test(b_iter, NULL)) {
+			b_iter = b_iter->lvl_nxt;
+			continue;
+		}
+
+		/* find the run of equality tests */
+		run_cnt = 0;
+		b_anchor = b_iter->lvl_prv;
+		do {
+			if (run_cnt == run_max) {
+				run_max += DISPATCH_MIN * 4;
+				run_new = zrealloc(run,
+						   run_cnt * sizeof(*run),
+						   run_max * sizeof(*run));
+				if (run_new == NULL) {
+					rc = -ENOMEM;
+					goto dispatch_return;
+				}
+				run = run_new;
+			}
+			run[run_cnt++] = b_iter;
+			b_iter = b_iter->lvl_nxt;
+		} while (b_iter != NULL &&
+			 _gen_bpf_dispatch_test(b_iter, run[run_cnt - 1]));
+		if (run_cnt < DISPATCH_MIN)
+			continue;
+
+		/* sort the run, duplicate values must be tested in order */
+		b_first = run[0];
+		i_iter = &run[run_cnt - 1]->blks[run[run_cnt - 1]->blk_cnt - 1];
+		jmp_exit = i_iter->jf;
+		qsort(run, run_cnt, sizeof(*run), _gen_bpf_dispatch_cmp);
+		for (iter = 1; iter < run_cnt; iter++) {
+			if (run[iter]->node->datum == run[iter - 1]->node->datum)
+				break;
+		}
+		if (iter < run_cnt)
+			continue;
+
+		b_root = _gen_bpf_dispatch_tree(state, run, 0, run_cnt,
+						&jmp_exit, b_first,
+						b_head, b_anchor);
+		if (b_root == NULL) {
+			rc = -ENOMEM;
+			goto dispatch_return;
+		}
+
+		/* the dispatch loads the accumulator, not the first test */
+		if (b_first->blk_cnt > 1) {
+			b_first->blks[0] = b_first->blks[b_first->blk_cnt - 1];
+			b_first->blk_cnt = 1;
+			b_first->acc_start = b_first->acc_end;
+		}
+
+		/* redirect the block before the run to the dispatch */
+		if (b_anchor == NULL)
+			continue;
+		for (iter = 0; iter < b_anchor->blk_cnt; iter++) {
+			i_iter = &b_anchor->blks[iter];
+			if (i_iter->jt.type == TGT_PTR_BLK &&
+			    i_iter->jt.tgt.blk == b_first)
+				i_iter->jt = _BPF_JMP_BLK(b_root);
+			if (i_iter->jf.type == TGT_PTR_BLK &&
+			    i_iter->jf.tgt.blk == b_first)
+				i_iter->jf = _BPF_JMP_BLK(b_root);
+		}
+	}
+
+dispatch_return:
+	zfree(run);
+	return rc;
+}
+
 /**
  * Generates the BPF instruction blocks for a given filter chain
  * @param state the BPF state
@@ -1116,6 +1468,10 @@ static struct bpf_blk *_gen_bpf_chain(struct bpf_state *state,
 			}
 			b_iter = b_next;
 		} while (b_iter != NULL);
+
+		/* lower any long runs of equality tests */
+		if (_gen_bpf_chain_dispatch(state, &b_head) < 0)
+			goto chain_failure;
 	}
 
 	/* resolve all of the blocks */
@@ -1150,11 +1506,8 @@ static struct bpf_blk *_gen_bpf_chain(struct bpf_state *state,
 	return b_head;
 
 chain_failure:
-	while (b_head != NULL) {
-		b_iter = b_head;
-		b_head = b_iter->lvl_nxt;
-		_blk_free(state, b_iter);
-	}
+	/* NOTE: the blocks on this level may already be linked to each other
+	 *       and to the hash table, leave them to _state_release() */
 	return NULL;
 }
 
@@ -1246,6 +1599,75 @@ static void _sys_priority_sort(struct db_sys_list *syscalls,
 	}
 }
 
+/**
+ * Compare two syscalls by weight
+ * @param a the first syscall
+ * @param b the second syscall
+ *
+ * Returns a positive value if @a should be tested before @b, a negative value
+ * if @b should be tested before @a, and zero if there is no preference.
+ * Syscalls are ordered by weight and then by priority.
+ *
+ */
+static int _sys_weight_cmp(const struct db_sys_list *a,
+			   const struct db_sys_list *b)
+{
+	if (a->weight != b->weight)
+		return (a->weight > b->weight ? 1 : -1);
+	if (a->priority != b->priority)
+		return (a->priority > b->priority ? 1 : -1);
+	return 0;
+}
+
+/**
+ * Sort the syscalls by weight
+ * @param syscalls the linked list of syscalls to be sorted
+ * @param s_head the head of the linked list to be returned to the caller
+ * @param s_tail the tail of the linked list to be returned to the caller
+ *
+ * With the linear filter layout every syscall test which does not match costs
+ * a single instruction, so the expected cost is minimized by testing the
+ * syscalls with the highest weight first; the priority is used to break ties.
+ *
+ */
+static void _sys_weight_sort(struct db_sys_list *syscalls,
+			     struct db_sys_list **s_head,
+			     struct db_sys_list **s_tail)
+{
+	struct db_sys_list *s_iter, *s_iter_b;
+
+	db_list_foreach(s_iter, syscalls) {
+		if (*s_head != NULL) {
+			s_iter_b = *s_head;
+			while ((s_iter_b->pri_nxt != NULL) &&
+			       (_sys_weight_cmp(s_iter, s_iter_b) <= 0))
+				s_iter_b = s_iter_b->pri_nxt;
+
+			if (_sys_weight_cmp(s_iter, s_iter_b) > 0) {
+				s_iter->pri_prv = s_iter_b->pri_prv;
+				s_iter->pri_nxt = s_iter_b;
+				if (s_iter_b == *s_head) {
+					(*s_head)->pri_prv = s_iter;
+					*s_head = s_iter;
+				} else {
+					s_iter->pri_prv->pri_nxt = s_iter;
+					s_iter->pri_nxt->pri_prv = s_iter;
+				}
+			} else {
+				s_iter->pri_prv = *s_tail;
+				s_iter->pri_nxt = NULL;
+				s_iter->pri_prv->pri_nxt = s_iter;
+				*s_tail = s_iter;
+			}
+		} else {
+			*s_head = s_iter;
+			*s_tail = s_iter;
+			(*s_head)->pri_prv = NULL;
+			(*s_head)->pri_nxt = NULL;
+		}
+	}
+}
+
 /**
  * Sort the syscalls
  * @param syscalls the linked list of syscalls to be sorted
@@ -1260,11 +1682,13 @@ static void _sys_sort(struct db_sys_list *syscalls,
 		      struct db_sys_list **s_tail,
 		      uint32_t optimize)
 {
-	if (optimize != 2)
-		_sys_priority_sort(syscalls, s_head, s_tail);
-	else
+	if (optimize == 2)
 		/* sort by number for the binary tree */
 		_sys_num_sort(syscalls, s_head, s_tail);
+	else if (optimize == 3)
+		_sys_weight_sort(syscalls, s_head, s_tail);
+	else
+		_sys_priority_sort(syscalls, s_head, s_tail);
 }
 
 /**
@@ -1316,6 +1740,10 @@ static inline bool _skip_syscall(struct bpf_state *state,
 	    (state->attr->api_tskip == 0 || syscall->num != -1))
 		return true;
 
+	/* only generate the syscalls in the current range */
+	if (syscall->num < state->sys_min || syscall->num > state->sys_max)
+		return true;
+
 	return false;
 }
 
@@ -1479,9 +1907,12 @@ out:
  * @param sys the syscall filter DB entry
  * @param nxt_hash the hash value of the next syscall filter DB entry
  * @param acc_reset accumulator reset flag
+ * @param cost the worst case cost of the argument filter, or NULL
  *
  * Generate the BPF instruction blocks for the given syscall filter and return
- * a pointer to the first block on success; returns NULL on failure.  It is
+ * a pointer to the first block on success; returns NULL on failure.  If @cost
+ * is not NULL it is set to the number of instructions executed after the
+ * syscall number matches in the worst case.  It is
  * important to note that the block returned has not been added to the hash
  * table, however, any linked/referenced blocks have been added to the hash
  * table.
@@ -1490,7 +1921,8 @@ out:
 static struct bpf_blk *_gen_bpf_syscall(struct bpf_state *state,
 					const struct db_sys_list *sys,
 					uint64_t nxt_hash,
-					bool acc_reset)
+					bool acc_reset,
+					unsigned int *cost)
 {
 	int rc;
 	struct bpf_instr instr;
@@ -1502,7 +1934,7 @@ static struct bpf_blk *_gen_bpf_syscall(struct bpf_state *state,
 	memset(&def_jump, 0, sizeof(def_jump));
 	def_jump = _BPF_JMP_HSH(state->def_hsh);
 
-	blk_s = _blk_alloc();
+	blk_s = _blk_alloc(state);
 	if (blk_s == NULL)
 		return NULL;
 
@@ -1527,10 +1959,10 @@ static struct bpf_blk *_gen_bpf_syscall(struct bpf_state *state,
 
 	/* generate the argument chains */
 	blk_c = _gen_bpf_chain(state, sys, sys->chains, &def_jump, &a_state);
-	if (blk_c == NULL) {
-		_blk_free(state, blk_s);
+	if (blk_c == NULL)
 		return NULL;
-	}
+	if (cost != NULL)
+		*cost = _blk_cost(state, blk_c);
 
 	/* syscall check */
 	_BPF_INSTR(instr, _BPF_OP(state->arch, BPF_JMP + BPF_JEQ),
@@ -1543,10 +1975,8 @@ static struct bpf_blk *_gen_bpf_syscall(struct bpf_state *state,
 
 	/* add to the hash table */
 	rc = _hsh_add(state, &blk_s, 1);
-	if (rc < 0) {
-		_blk_free(state, blk_s);
+	if (rc < 0)
 		return NULL;
-	}
 
 	return blk_s;
 }
@@ -1565,19 +1995,37 @@ static int _gen_bpf_syscalls(struct bpf_state *state,
 			     unsigned int *bintree_levels)
 {
 	struct db_sys_list *s_head = NULL, *s_tail = NULL, *s_iter;
+	struct bpf_blk *b_end;
 	unsigned int syscall_cnt, empty_cnt = 0;
 	uint64_t *bintree_hashes = NULL, nxt_hsh;
 	unsigned int *bintree_syscalls = NULL;
+	unsigned int cost = 0, cost_cnt = 0;
 	bool acc_reset;
 	int rc = 0;
 
 	state->arch = db->arch;
-	state->b_head = NULL;
-	state->b_tail = NULL;
-	state->b_new = NULL;
+	b_end = state->b_head;
 
 	*blks_added = 0;
 
+	if (optimize == 3) {
+		/* find the cost of the syscall tests with the default
+		 * ordering, the argument filters are accounted for below as
+		 * their cost does not depend on the ordering */
+		_sys_sort(db->syscalls, &s_head, &s_tail, 1);
+		if (db_secondary != NULL)
+			_sys_sort(db_secondary->syscalls, &s_head, &s_tail, 1);
+		for (s_iter = s_head; s_iter != NULL; s_iter = s_iter->pri_nxt) {
+			if (_skip_syscall(state, s_iter))
+				continue;
+			cost_cnt++;
+			state->cost_weight += s_iter->weight;
+			state->cost_before += (uint64_t)s_iter->weight * cost_cnt;
+		}
+		s_head = NULL;
+		s_tail = NULL;
+	}
+
 	/* sort the syscall list */
 	_sys_sort(db->syscalls, &s_head, &s_tail, optimize);
 	if (db_secondary != NULL)
@@ -1592,8 +2040,9 @@ static int _gen_bpf_syscalls(struct bpf_state *state,
 			goto out;
 	}
 
-	if ((state->arch->token == SCMP_ARCH_X86_64 ||
-	     state->arch->token == SCMP_ARCH_X32) && (db_secondary == NULL))
+	if (state->arch->token == SCMP_ARCH_X86_64 ||
+	    state->arch->token == SCMP_ARCH_X32)
+		/* The ABI filtering loads the syscall */
 		acc_reset = false;
 	else
 		acc_reset = true;
@@ -1617,15 +2066,22 @@ static int _gen_bpf_syscalls(struct bpf_state *state,
 			 * default hash */
 			nxt_hsh = state->def_hsh;
 		else
-			nxt_hsh = state->b_head == NULL ?
+			nxt_hsh = state->b_head == b_end ?
 				  state->def_hsh : state->b_head->hash;
 
 		/* build the syscall filter */
 		state->b_new = _gen_bpf_syscall(state, s_iter, nxt_hsh,
 						(s_iter == s_head ?
-						 acc_reset : false));
+						 acc_reset : false),
+						(optimize == 3 ? &cost : NULL));
 		if (state->b_new == NULL)
 			goto out;
+		if (optimize == 3) {
+			/* the syscalls are generated in reverse order */
+			state->cost_before += (uint64_t)s_iter->weight * cost;
+			state->cost_after += (uint64_t)s_iter->weight *
+					     (cost + cost_cnt - syscall_cnt);
+		}
 
 		/* add the filter to the list head */
 		state->b_new->prev = NULL;
@@ -1657,13 +2113,88 @@ static int _gen_bpf_syscalls(struct bpf_state *state,
 
 out:
 	if (bintree_hashes != NULL)
-		free(bintree_hashes);
+		zfree(bintree_hashes);
 	if (bintree_syscalls != NULL)
-		free(bintree_syscalls);
+		zfree(bintree_syscalls);
 
 	return rc;
 }
 
+/**
+ * Generate the BPF instruction blocks for the combined x86_64/x32 syscalls
+ * @param state the BPF state
+ * @param db the filter DB
+ * @param db_secondary the secondary DB
+ * @param blks_added number of blocks added by this function
+ * @param optimize the optimization level
+ *
+ * The x86_64 and x32 ABIs share a single architecture token so their filters
+ * are combined.  Instead of testing the syscalls from both ABIs in a single
+ * list, the syscall number is split on the x32 syscall bit so that each ABI
+ * only has to search through its own syscalls; identical argument filters and
+ * actions are still shared between the two ABIs through the block hash table.
+ * The x32 syscalls are placed after the x86_64 syscalls.  Returns zero on
+ * success, negative values on failure.
+ *
+ */
+static int _gen_bpf_syscalls_x32(struct bpf_state *state,
+				 const struct db_filter *db,
+				 const struct db_filter *db_secondary,
+				 unsigned int *blks_added, uint32_t optimize)
+{
+	int rc;
+	unsigned int blk_cnt = 0, bintree_levels = 0;
+	struct bpf_instr instr;
+	struct bpf_blk *b_x32;
+
+	/* the x32 syscalls, which includes the -1 syscall */
+	state->sys_min = X32_SYSCALL_BIT;
+	state->sys_max = UINT32_MAX;
+	rc = _gen_bpf_syscalls(state, db, db_secondary, blks_added,
+			       optimize, &bintree_levels);
+	if (rc < 0)
+		goto out;
+	blk_cnt += *blks_added;
+	b_x32 = state->b_head;
+
+	/* the x86_64 syscalls */
+	state->sys_min = 0;
+	state->sys_max = X32_SYSCALL_BIT - 1;
+	rc = _gen_bpf_syscalls(state, db, db_secondary, blks_added,
+			       optimize, &bintree_levels);
+	if (rc < 0)
+		goto out;
+	blk_cnt += *blks_added;
+
+	/* split the ABIs */
+	_BPF_INSTR(instr, _BPF_OP(state->arch, BPF_LD + BPF_ABS),
+		   _BPF_JMP_NO, _BPF_JMP_NO, _BPF_SYSCALL(state->arch));
+	state->b_new = _blk_append(state, NULL, &instr);
+	if (state->b_new == NULL) {
+		rc = -ENOMEM;
+		goto out;
+	}
+	state->b_new->acc_end = _ACC_STATE_OFFSET(_BPF_OFFSET_SYSCALL);
+	_BPF_INSTR(instr, _BPF_OP(state->arch, BPF_JMP + BPF_JGE),
+		   _BPF_JMP_HSH(state->def_hsh), _BPF_JMP_HSH(state->def_hsh),
+		   _BPF_K(state->arch, X32_SYSCALL_BIT));
+	if (b_x32 != NULL)
+		instr.jt = _BPF_JMP_HSH(b_x32->hash);
+	if (state->b_head != b_x32)
+		instr.jf = _BPF_JMP_HSH(state->b_head->hash);
+	rc = _gen_bpf_insert(state, &instr, &state->b_new, &state->b_head,
+			     state->b_new);
+	if (rc < 0)
+		goto out;
+	blk_cnt++;
+
+out:
+	state->sys_min = 0;
+	state->sys_max = UINT32_MAX;
+	*blks_added = blk_cnt;
+	return rc;
+}
+
 /**
  * Generate the BPF instruction blocks for a given filter/architecture
  * @param state the BPF state
@@ -1684,16 +2215,30 @@ static struct bpf_blk *_gen_bpf_arch(struct bpf_state *state,
 	int rc;
 	unsigned int blk_cnt = 0, blks_added = 0, bintree_levels = 0;
 	struct bpf_instr instr;
-	struct bpf_blk *b_iter, *b_bintree;
+	struct bpf_blk *b_bintree;
 
 	state->arch = db->arch;
+	state->b_head = NULL;
+	state->b_tail = NULL;
+	state->b_new = NULL;
+	state->sys_min = 0;
+	state->sys_max = UINT32_MAX;
 
-	/* create the syscall filters and add them to block list group */
-	rc = _gen_bpf_syscalls(state, db, db_secondary, &blks_added, optimize,
-			       &bintree_levels);
-	if (rc < 0)
-		goto arch_failure;
-	blk_cnt += blks_added;
+	if (db_secondary != NULL) {
+		/* create the combined x86_64/x32 syscall filters */
+		rc = _gen_bpf_syscalls_x32(state, db, db_secondary,
+					   &blks_added, optimize);
+		if (rc < 0)
+			goto arch_failure;
+		blk_cnt += blks_added;
+	} else {
+		/* create the syscall filters and add them to block list */
+		rc = _gen_bpf_syscalls(state, db, NULL, &blks_added,
+				       optimize, &bintree_levels);
+		if (rc < 0)
+			goto arch_failure;
+		blk_cnt += blks_added;
+	}
 
 	if (bintree_levels > 0) {
 		_BPF_INSTR(instr, _BPF_OP(state->arch, BPF_LD + BPF_ABS),
@@ -1789,16 +2334,10 @@ static struct bpf_blk *_gen_bpf_arch(struct bpf_state *state,
 	return state->b_head;
 
 arch_failure:
-	/* NOTE: we do the cleanup here and not just return an error as all of
-	 * the instruction blocks may not be added to the hash table when we
-	 * hit an error */
+	/* NOTE: the instruction blocks are owned by the BPF state, so they are
+	 * released by _state_release() even if they never made it into the
+	 * hash table */
 	state->arch = NULL;
-	b_iter = state->b_head;
-	while (b_iter != NULL) {
-		state->b_new = b_iter->next;
-		_blk_free(state, b_iter);
-		b_iter = state->b_new;
-	}
 	return NULL;
 }
 
@@ -1877,8 +2416,8 @@ static int _gen_bpf_build_jmp_ret(struct bpf_state *state,
 	/* NOTE - we need to be careful here, we're giving the block a hash
 	 *	  value (this is a sneaky way to ensure we leverage the
 	 *	  inserted long jumps as much as possible) but we never add the
-	 *	  block to the hash table so it won't get cleaned up
-	 *	  automatically */
+	 *	  block to the hash table, it is only cleaned up through the
+	 *	  state's ownership list */
 	b_new->hash = tgt_hash;
 
 	/* insert the jump after the current jumping block */
@@ -1966,8 +2505,8 @@ static int _gen_bpf_build_jmp(struct bpf_state *state,
 	/* NOTE - we need to be careful here, we're giving the block a hash
 	 *	  value (this is a sneaky way to ensure we leverage the
 	 *	  inserted long jumps as much as possible) but we never add the
-	 *	  block to the hash table so it won't get cleaned up
-	 *	  automatically */
+	 *	  block to the hash table, it is only cleaned up through the
+	 *	  state's ownership list */
 	b_new->hash = tgt_hash;
 
 	/* insert the jump after the current jumping block */
@@ -2182,8 +2721,8 @@ static int _gen_bpf_build_bpf(struct bpf_state *state,
 
 
 	/* NOTE - from here to the end of the function we need to fail via the
-	 *	  the build_bpf_free_blks label, not just return an error; see
-	 *	  the _gen_bpf_build_jmp() function for details */
+	 *	  the build_bpf_free_blks label, not just return an error, so
+	 *	  the state is reset properly */
 
 	/* check for long jumps and insert if necessary, we also verify that
 	 * all our jump targets are valid at this point in the process */
@@ -2300,29 +2839,47 @@ static int _gen_bpf_build_bpf(struct bpf_state *state,
 	return 0;
 
 build_bpf_free_blks:
-	b_iter = b_head;
-	while (b_iter != NULL) {
-		b_jmp = b_iter->next;
-		_hsh_remove(state, b_iter->hash);
-		__blk_free(state, b_iter);
-		b_iter = b_jmp;
-	}
+	/* NOTE: the remaining blocks are released by _state_release() */
 state_reset:
 	state->arch = NULL;
 	return rc;
 }
 
+/**
+ * Convert an expected cost sum into an average
+ * @param sum the weighted instruction count
+ * @param weight the total weight
+ *
+ * Return the average instruction count in hundredths of an instruction,
+ * saturating at UINT32_MAX.
+ *
+ */
+static uint32_t _gen_bpf_cost_avg(uint64_t sum, uint64_t weight)
+{
+	uint64_t avg;
+
+	if (weight == 0)
+		return 0;
+
+	avg = (sum / weight) * 100 + ((sum % weight) * 100) / weight;
+	return (avg > UINT32_MAX ? UINT32_MAX : avg);
+}
+
 /**
  * Generate a BPF representation of the filter DB
  * @param col the seccomp filter collection
  * @param prgm_ptr the bpf program pointer
+ * @param stats the filter statistics, or NULL
  *
  * This function generates a BPF representation of the given filter collection.
- * Returns zero on success, negative values on failure.
+ * If @stats is not NULL the expected syscall cost is recorded when the filter
+ * is generated with SCMP_FLTATR_CTL_OPTIMIZE level 3.  Returns zero on success,
+ * negative values on failure.
  *
  */
 int gen_bpf_generate(const struct db_filter_col *col,
-		     struct bpf_program **prgm_ptr)
+		     struct bpf_program **prgm_ptr,
+		     struct db_filter_stats *stats)
 {
 	int rc;
 	struct bpf_state state;
@@ -2342,12 +2899,733 @@ int gen_bpf_generate(const struct db_filter_col *col,
 	if (rc == 0) {
 		*prgm_ptr = state.bpf;
 		state.bpf = NULL;
+		if (stats != NULL) {
+			stats->cost_before = _gen_bpf_cost_avg(state.cost_before,
+							       state.cost_weight);
+			stats->cost_after = _gen_bpf_cost_avg(state.cost_after,
+							      state.cost_weight);
+		}
 	}
 	_state_release(&state);
 
 	return rc;
 }
 
+/**
+ * Load an instruction for the minimization pass
+ * @param arch the architecture definition
+ * @param raw the raw BPF instruction
+ * @param pc the instruction's index in the program
+ * @param cnt the number of instructions in the program
+ * @param instr the decoded instruction
+ *
+ * Convert the instruction into host byte order and resolve the relative jump
+ * offsets into absolute instruction indices.  Returns zero on success,
+ * negative values on failure.
+ *
+ */
+static int _min_instr_load(const struct arch_def *arch,
+			   const bpf_instr_raw *raw, unsigned int pc,
+			   unsigned int cnt, struct min_instr *instr)
+{
+	/* NOTE: the host/target byte swaps are their own inverse */
+	instr->code = _htot16(arch, raw->code);
+	instr->k = _htot32(arch, raw->k);
+	instr->jt = pc + 1;
+	instr->jf = pc + 1;
+	if (BPF_CLASS(instr->code) != BPF_JMP)
+		return 0;
+
+	if (BPF_OP(instr->code) == BPF_JA) {
+		if (instr->k >= cnt - instr->jt)
+			return -EFAULT;
+		instr->jt += instr->k;
+		instr->jf = instr->jt;
+	} else {
+		instr->jt += raw->jt;
+		instr->jf += raw->jf;
+	}
+	if (instr->jt >= cnt || instr->jf >= cnt)
+		return -EFAULT;
+
+	return 0;
+}
+
+/**
+ * Store an instruction from the minimization pass
+ * @param arch the architecture definition
+ * @param instr the decoded instruction
+ * @param pc the instruction's index in the program
+ * @param raw the raw BPF instruction
+ *
+ * Convert the instruction back into target byte order with relative jump
+ * offsets.  Returns zero on success, negative values on failure.
+ *
+ */
+static int _min_instr_store(const struct arch_def *arch,
+			    const struct min_instr *instr, unsigned int pc,
+			    bpf_instr_raw *raw)
+{
+	raw->code = _htot16(arch, instr->code);
+	raw->jt = 0;
+	raw->jf = 0;
+	raw->k = _htot32(arch, instr->k);
+	if (BPF_CLASS(instr->code) != BPF_JMP)
+		return 0;
+
+	if (BPF_OP(instr->code) == BPF_JA) {
+		raw->k = _htot32(arch, instr->jt - (pc + 1));
+		return 0;
+	}
+	if (instr->jt - (pc + 1) > _BPF_JMP_MAX ||
+	    instr->jf - (pc + 1) > _BPF_JMP_MAX)
+		return -EFAULT;
+	raw->jt = instr->jt - (pc + 1);
+	raw->jf = instr->jf - (pc + 1);
+
+	return 0;
+}
+
+/**
+ * Find the successors of an instruction
+ * @param instr the instruction
+ * @param pc the instruction's index in the program
+ * @param succ the successor indices
+ *
+ * Returns the number of successors written to @succ.
+ *
+ */
+static unsigned int _min_instr_succ(const struct min_instr *instr,
+				    unsigned int pc, unsigned int succ[2])
+{
+	switch (BPF_CLASS(instr->code)) {
+	case BPF_RET:
+		return 0;
+	case BPF_JMP:
+		succ[0] = instr->jt;
+		succ[1] = instr->jf;
+		return (instr->jt == instr->jf ? 1 : 2);
+	default:
+		succ[0] = pc + 1;
+		return 1;
+	}
+}
+
+/**
+ * Determine if an instruction is a conditional jump
+ * @param instr the instruction
+ */
+static bool _min_instr_cond(const struct min_instr *instr)
+{
+	return (BPF_CLASS(instr->code) == BPF_JMP &&
+		BPF_OP(instr->code) != BPF_JA);
+}
+
+/**
+ * Determine the accumulator state after executing an instruction
+ * @param instr the instruction
+ * @param acc the accumulator state before the instruction
+ *
+ * Returns the accumulator state after the instruction, the accumulator is
+ * only tracked while it holds a masked seccomp_data word.
+ *
+ */
+static struct acc_state _min_instr_acc(const struct min_instr *instr,
+				       struct acc_state acc)
+{
+	switch (BPF_CLASS(instr->code)) {
+	case BPF_LD:
+		if (instr->code == BPF_LD + BPF_W + BPF_ABS &&
+		    (instr->k % sizeof(uint32_t)) == 0 &&
+		    instr->k < sizeof(struct seccomp_data))
+			return _ACC_STATE_OFFSET(instr->k);
+		return _ACC_STATE_UNDEF;
+	case BPF_ALU:
+		if (instr->code == BPF_ALU + BPF_AND + BPF_K &&
+		    acc.offset >= 0) {
+			acc.mask &= instr->k;
+			return acc;
+		}
+		return _ACC_STATE_UNDEF;
+	case BPF_MISC:
+		if (BPF_MISCOP(instr->code) == BPF_TXA)
+			return _ACC_STATE_UNDEF;
+		return acc;
+	default:
+		return acc;
+	}
+}
+
+/**
+ * Analyze the program for the minimization pass
+ * @param prog the decoded program
+ * @param cnt the number of instructions in the program
+ * @param info the per-instruction analysis results
+ *
+ * Determine which instructions are reachable, the accumulator state on entry
+ * to each instruction, and which registers are live on entry to each
+ * instruction.  Since classic BPF only jumps forward a single pass in each
+ * direction is sufficient.
+ *
+ */
+static void _min_analyze(const struct min_instr *prog, unsigned int cnt,
+			 struct min_info *info)
+{
+	unsigned int iter, s_iter, s_cnt;
+	unsigned int succ[2];
+	bool live_a, live_x;
+	struct acc_state acc;
+	const struct min_instr *instr;
+
+	memset(info, 0, sizeof(*info) * cnt);
+	info[0].reach = true;
+	info[0].acc = _ACC_STATE_UNDEF;
+	for (iter = 0; iter < cnt; iter++) {
+		if (!info[iter].reach)
+			continue;
+		instr = &prog[iter];
+		acc = _min_instr_acc(instr, info[iter].acc);
+		s_cnt = _min_instr_succ(instr, iter, succ);
+		for (s_iter = 0; s_iter < s_cnt; s_iter++) {
+			if (!info[succ[s_iter]].reach) {
+				info[succ[s_iter]].reach = true;
+				info[succ[s_iter]].acc = acc;
+			} else if (!_ACC_CMP_EQ(info[succ[s_iter]].acc, acc))
+				info[succ[s_iter]].acc = _ACC_STATE_UNDEF;
+		}
+	}
+
+	iter = cnt;
+	while (iter-- > 0) {
+		instr = &prog[iter];
+		live_a = false;
+		live_x = false;
+		s_cnt = _min_instr_succ(instr, iter, succ);
+		for (s_iter = 0; s_iter < s_cnt; s_iter++) {
+			live_a |= info[succ[s_iter]].live_a;
+			live_x |= info[succ[s_iter]].live_x;
+		}
+		info[iter].live_a_out = live_a;
+		info[iter].live_x_out = live_x;
+
+		switch (BPF_CLASS(instr->code)) {
+		case BPF_LD:
+			live_a = false;
+			if (BPF_MODE(instr->code) == BPF_IND)
+				live_x = true;
+			break;
+		case BPF_LDX:
+			live_x = false;
+			break;
+		case BPF_ST:
+			live_a = true;
+			break;
+		case BPF_STX:
+			live_x = true;
+			break;
+		case BPF_ALU:
+			live_a = true;
+			if (BPF_SRC(instr->code) == BPF_X)
+				live_x = true;
+			break;
+		case BPF_JMP:
+			if (BPF_OP(instr->code) == BPF_JA)
+				break;
+			live_a = true;
+			if (BPF_SRC(instr->code) == BPF_X)
+				live_x = true;
+			break;
+		case BPF_RET:
+			live_a = (BPF_RVAL(instr->code) == BPF_A);
+			live_x = (BPF_RVAL(instr->code) == BPF_X);
+			break;
+		case BPF_MISC:
+			if (BPF_MISCOP(instr->code) == BPF_TAX) {
+				live_a = true;
+				live_x = false;
+			} else {
+				live_a = false;
+				live_x = true;
+			}
+			break;
+		}
+		info[iter].live_a = live_a;
+		info[iter].live_x = live_x;
+	}
+}
+
+/**
+ * Determine if an instruction can be removed without changing the program
+ * @param prog the decoded program
+ * @param info the per-instruction analysis results
+ * @param pc the instruction's index in the program
+ *
+ * Unreachable instructions, jumps to the next instruction, and loads whose
+ * result is never used can all be removed.
+ *
+ */
+static bool _min_instr_dead(const struct min_instr *prog,
+			    const struct min_info *info, unsigned int pc)
+{
+	const struct min_instr *instr = &prog[pc];
+
+	if (!info[pc].reach)
+		return true;
+
+	switch (BPF_CLASS(instr->code)) {
+	case BPF_LD:
+		/* indirect loads can abort the filter */
+		if (BPF_MODE(instr->code) == BPF_IND)
+			return false;
+		return !info[pc].live_a_out;
+	case BPF_LDX:
+		if (BPF_MODE(instr->code) == BPF_MSH)
+			return false;
+		return !info[pc].live_x_out;
+	case BPF_ALU:
+		/* division by zero aborts the filter */
+		if (BPF_SRC(instr->code) == BPF_X &&
+		    (BPF_OP(instr->code) == BPF_DIV ||
+		     BPF_OP(instr->code) == BPF_MOD))
+			return false;
+		return !info[pc].live_a_out;
+	case BPF_JMP:
+		return (BPF_OP(instr->code) == BPF_JA && instr->jt == pc + 1);
+	case BPF_MISC:
+		if (BPF_MISCOP(instr->code) == BPF_TAX)
+			return !info[pc].live_x_out;
+		return !info[pc].live_a_out;
+	default:
+		return false;
+	}
+}
+
+/**
+ * Evaluate a conditional jump against a known value
+ * @param op the jump operation
+ * @param k the jump's immediate value
+ * @param val the accumulator value
+ */
+static bool _min_test(uint16_t op, uint32_t k, uint32_t val)
+{
+	switch (op) {
+	case BPF_JEQ:
+		return val == k;
+	case BPF_JGT:
+		return val > k;
+	case BPF_JGE:
+		return val >= k;
+	default:
+		return (val & k) != 0;
+	}
+}
+
+/**
+ * Determine the range of accumulator values for which a jump is taken
+ * @param op the jump operation
+ * @param k the jump's immediate value
+ * @param res the outcome of the jump
+ * @param lo the lowest matching value
+ * @param hi the highest matching value
+ *
+ * Returns false if the matching values can not be described by a single
+ * range, true otherwise.
+ *
+ */
+static bool _min_range(uint16_t op, uint32_t k, bool res,
+		       int64_t *lo, int64_t *hi)
+{
+	switch (op) {
+	case BPF_JEQ:
+		if (!res)
+			return false;
+		*lo = k;
+		*hi = k;
+		return true;
+	case BPF_JGT:
+		*lo = (res ? (int64_t)k + 1 : 0);
+		*hi = (res ? UINT32_MAX : k);
+		return true;
+	case BPF_JGE:
+		*lo = (res ? k : 0);
+		*hi = (res ? UINT32_MAX : (int64_t)k - 1);
+		return true;
+	default:
+		return false;
+	}
+}
+
+/**
+ * Evaluate a conditional jump using the known facts
+ * @param facts the known facts
+ * @param same true if the accumulator is unchanged since the known test
+ * @param acc the accumulator state
+ * @param op the jump operation
+ * @param k the jump's immediate value
+ *
+ * Returns 1 if the jump is always taken, 0 if it is never taken, and -1 if
+ * the outcome is not known.
+ *
+ */
+static int _min_eval(const struct min_facts *facts, bool same,
+		     struct acc_state acc, uint16_t op, uint32_t k)
+{
+	unsigned int word;
+	int64_t s_lo, s_hi, t_lo, t_hi;
+
+	if (facts == NULL)
+		return -1;
+
+	/* is every bit of the accumulator known? */
+	if (acc.offset >= 0) {
+		word = acc.offset / sizeof(uint32_t);
+		if ((facts->k_mask[word] & acc.mask) == acc.mask)
+			return _min_test(op, k, facts->k_val[word] & acc.mask);
+	}
+
+	/* does the earlier test on the same value decide this test? */
+	if (!same || !facts->test)
+		return -1;
+	if (op == facts->op && k == facts->k)
+		return facts->res;
+	if (!_min_range(op, k, true, &t_lo, &t_hi))
+		return -1;
+	if (t_lo > t_hi)
+		return 0;
+	if (!_min_range(facts->op, facts->k, facts->res, &s_lo, &s_hi)) {
+		/* the earlier test was a failed equality test */
+		if (facts->op != BPF_JEQ)
+			return -1;
+		if (t_lo == 0 && t_hi == UINT32_MAX)
+			return 1;
+		if (facts->k == 0 && t_lo == 1 && t_hi == UINT32_MAX)
+			return 1;
+		if (t_lo == facts->k && t_hi == facts->k)
+			return 0;
+		return -1;
+	}
+	if (s_lo > s_hi)
+		return -1;
+	if (t_lo <= s_lo && s_hi <= t_hi)
+		return 1;
+	if (s_hi < t_lo || s_lo > t_hi)
+		return 0;
+	return -1;
+}
+
+/**
+ * Record the facts known after a conditional jump
+ * @param facts the known facts
+ * @param instr the conditional jump
+ * @param acc the accumulator state at the jump
+ * @param res the outcome of the jump
+ */
+static void _min_facts(struct min_facts *facts, const struct min_instr *instr,
+		       struct acc_state acc, bool res)
+{
+	unsigned int word;
+
+	memset(facts, 0, sizeof(*facts));
+	if (BPF_SRC(instr->code) != BPF_K)
+		return;
+
+	facts->test = true;
+	facts->op = BPF_OP(instr->code);
+	facts->k = instr->k;
+	facts->res = res;
+	if (acc.offset < 0)
+		return;
+
+	word = acc.offset / sizeof(uint32_t);
+	if (facts->op == BPF_JEQ && res) {
+		facts->k_mask[word] = acc.mask;
+		facts->k_val[word] = instr->k & acc.mask;
+	} else if (facts->op == BPF_JSET && !res) {
+		facts->k_mask[word] = instr->k & acc.mask;
+		facts->k_val[word] = 0;
+	}
+}
+
+/**
+ * Follow the program forward from an instruction using the known facts
+ * @param prog the decoded program
+ * @param cnt the number of instructions in the program
+ * @param info the per-instruction analysis results
+ * @param pc the starting instruction
+ * @param acc the accumulator state at the starting instruction
+ * @param facts the known facts, may be NULL
+ * @param limit the furthest instruction that may be returned
+ * @param goal an instruction to look for
+ * @param goal_hit set to true if @goal was reached
+ *
+ * Execute the program from @pc for as long as the outcome of every jump is
+ * decided by @facts and the accumulator can be tracked.  Returns the furthest
+ * instruction, no further than @limit, where execution can resume with the
+ * same result as starting from @pc.
+ *
+ */
+static unsigned int _min_walk(const struct min_instr *prog, unsigned int cnt,
+			      const struct min_info *info, unsigned int pc,
+			      struct acc_state acc,
+			      const struct min_facts *facts,
+			      unsigned int limit, unsigned int goal,
+			      bool *goal_hit)
+{
+	int res;
+	bool same = true;
+	unsigned int stop = pc;
+	struct acc_state acc_orig = acc;
+	const struct min_instr *instr;
+
+	while (pc < cnt) {
+		/* we can stop here if the accumulator matches or is unused */
+		if (same || !info[pc].live_a) {
+			if (pc <= limit)
+				stop = pc;
+			if (pc == goal && goal_hit != NULL)
+				*goal_hit = true;
+		}
+
+		instr = &prog[pc];
+		switch (BPF_CLASS(instr->code)) {
+		case BPF_LD:
+		case BPF_ALU:
+			acc = _min_instr_acc(instr, acc);
+			if (acc.offset < 0)
+				return stop;
+			same = (acc_orig.offset >= 0 &&
+				_ACC_CMP_EQ(acc, acc_orig));
+			pc++;
+			break;
+		case BPF_JMP:
+			if (BPF_OP(instr->code) == BPF_JA) {
+				pc = instr->jt;
+				break;
+			}
+			if (BPF_SRC(instr->code) != BPF_K)
+				return stop;
+			res = _min_eval(facts, same, acc,
+					BPF_OP(instr->code), instr->k);
+			if (res < 0)
+				return stop;
+			pc = (res ? instr->jt : instr->jf);
+			break;
+		default:
+			return stop;
+		}
+	}
+
+	return stop;
+}
+
+/**
+ * Simplify the jumps in the program
+ * @param prog the decoded program
+ * @param cnt the number of instructions in the program
+ * @param info the per-instruction analysis results
+ *
+ * Thread jumps past any tests whose outcome is already known, and remove tests
+ * which do not change the result of the program.  Returns true if the program
+ * was changed, false otherwise.
+ *
+ */
+static bool _min_jumps(struct min_instr *prog, unsigned int cnt,
+		       const struct min_info *info)
+{
+	bool changed = false;
+	bool hit;
+	unsigned int iter, tgt, limit;
+	struct min_facts f_true, f_false;
+	struct min_instr *instr;
+
+	for (iter = 0; iter < cnt; iter++) {
+		instr = &prog[iter];
+		if (!info[iter].reach || BPF_CLASS(instr->code) != BPF_JMP)
+			continue;
+
+		if (BPF_OP(instr->code) == BPF_JA) {
+			/* NOTE: we don't track the accumulator across jumps
+			 *       as new paths may have been added to them */
+			tgt = _min_walk(prog, cnt, info, instr->jt,
+					_ACC_STATE_UNDEF, NULL,
+					UINT_MAX, UINT_MAX, NULL);
+			if (tgt != instr->jt) {
+				instr->jt = tgt;
+				instr->jf = tgt;
+				changed = true;
+			}
+			continue;
+		}
+		if (BPF_SRC(instr->code) != BPF_K)
+			continue;
+
+		/* skip over any tests decided by this test */
+		limit = iter + 1 + _BPF_JMP_MAX;
+		_min_facts(&f_true, instr, info[iter].acc, true);
+		_min_facts(&f_false, instr, info[iter].acc, false);
+		tgt = _min_walk(prog, cnt, info, instr->jt, info[iter].acc,
+				&f_true, limit, UINT_MAX, NULL);
+		if (tgt != instr->jt) {
+			instr->jt = tgt;
+			changed = true;
+		}
+		tgt = _min_walk(prog, cnt, info, instr->jf, info[iter].acc,
+				&f_false, limit, UINT_MAX, NULL);
+		if (tgt != instr->jf) {
+			instr->jf = tgt;
+			changed = true;
+		}
+
+		/* remove the test if both paths end up in the same place */
+		if (instr->jt != instr->jf) {
+			hit = false;
+			_min_walk(prog, cnt, info, instr->jf, info[iter].acc,
+				  &f_true, limit, instr->jt, &hit);
+			if (hit)
+				instr->jt = instr->jf;
+		}
+		if (instr->jt != instr->jf) {
+			hit = false;
+			_min_walk(prog, cnt, info, instr->jt, info[iter].acc,
+				  &f_false, limit, instr->jf, &hit);
+			if (hit)
+				instr->jf = instr->jt;
+		}
+		if (instr->jt == instr->jf) {
+			instr->code = BPF_JMP + BPF_JA;
+			instr->k = 0;
+			changed = true;
+		}
+	}
+
+	return changed;
+}
+
+/**
+ * Remove the dead instructions from the program
+ * @param prog the decoded program
+ * @param cnt the number of instructions in the program
+ * @param info the per-instruction analysis results
+ * @param map scratch space for the new instruction indices
+ *
+ * Returns the new number of instructions in the program.
+ *
+ */
+static unsigned int _min_compact(struct min_instr *prog, unsigned int cnt,
+				 struct min_info *info, unsigned int *map)
+{
+	unsigned int iter, nxt = 0;
+	unsigned int cnt_new = 0;
+
+	for (iter = 0; iter < cnt; iter++) {
+		info[iter].dead = _min_instr_dead(prog, info, iter);
+		if (!info[iter].dead)
+			cnt_new++;
+	}
+	if (cnt_new == cnt)
+		return cnt;
+
+	/* a removed instruction is either unreachable or continues on to the
+	 * next instruction, so any jumps to it can be redirected to the next
+	 * remaining instruction */
+	iter = cnt;
+	while (iter-- > 0) {
+		if (!info[iter].dead)
+			nxt = --cnt_new;
+		map[iter] = nxt;
+	}
+	for (iter = 0; iter < cnt; iter++) {
+		if (info[iter].dead)
+			continue;
+		if (BPF_CLASS(prog[iter].code) == BPF_JMP) {
+			prog[iter].jt = map[prog[iter].jt];
+			prog[iter].jf = map[prog[iter].jf];
+		}
+		prog[map[iter]] = prog[iter];
+		cnt_new++;
+	}
+
+	return cnt_new;
+}
+
+/**
+ * Minimize a BPF program
+ * @param col the seccomp filter collection
+ * @param prgm the BPF program
+ * @param stats the filter statistics
+ *
+ * This function removes any tests and instructions from the BPF program which
+ * do not affect the result of the filter: tests already decided by an earlier
+ * test, tests whose paths converge, and unused loads.  The number of removed
+ * tests and instructions is recorded in @stats.  Returns zero on success,
+ * negative values on failure.
+ *
+ */
+int gen_bpf_minimize(const struct db_filter_col *col,
+		     struct bpf_program *prgm, struct db_filter_stats *stats)
+{
+	int rc = 0;
+	unsigned int iter, cnt, cnt_new;
+	unsigned int tests = 0, tests_new = 0;
+	bool changed;
+	const struct arch_def *arch;
+	struct min_instr *prog = NULL;
+	struct min_info *info = NULL;
+	unsigned int *map = NULL;
+
+	if (col->filter_cnt == 0 || prgm->blk_cnt == 0)
+		return -EINVAL;
+	arch = col->filters[0]->arch;
+	cnt = prgm->blk_cnt;
+
+	prog = zmalloc(sizeof(*prog) * cnt);
+	info = zmalloc(sizeof(*info) * cnt);
+	map = zmalloc(sizeof(*map) * cnt);
+	if (prog == NULL || info == NULL || map == NULL) {
+		rc = -ENOMEM;
+		goto minimize_out;
+	}
+
+	for (iter = 0; iter < cnt; iter++) {
+		rc = _min_instr_load(arch, &prgm->blks[iter], iter, cnt,
+				     &prog[iter]);
+		if (rc < 0)
+			goto minimize_out;
+		if (_min_instr_cond(&prog[iter]))
+			tests++;
+	}
+
+	do {
+		_min_analyze(prog, cnt, info);
+		changed = _min_jumps(prog, cnt, info);
+		if (changed)
+			_min_analyze(prog, cnt, info);
+		cnt_new = _min_compact(prog, cnt, info, map);
+		if (cnt_new != cnt)
+			changed = true;
+		cnt = cnt_new;
+	} while (changed);
+
+	for (iter = 0; iter < cnt; iter++) {
+		rc = _min_instr_store(arch, &prog[iter], iter,
+				      &prgm->blks[iter]);
+		if (rc < 0)
+			goto minimize_out;
+		if (_min_instr_cond(&prog[iter]))
+			tests_new++;
+	}
+
+	stats->min_nodes = tests - tests_new;
+	stats->min_insns = prgm->blk_cnt - cnt;
+	prgm->blk_cnt = cnt;
+
+minimize_out:
+	zfree(prog);
+	zfree(info);
+	zfree(map);
+	return rc;
+}
+
 /**
  * Free memory associated with a BPF representation
  * @param program the BPF representation
@@ -28,6 +28,8 @@
 #include "db.h"
 #include "system.h"
 
+struct db_filter_stats;
+
 /* NOTE - do not change this structure, it is part of the prctl() API */
 struct bpf_program {
 	uint16_t blk_cnt;
@@ -37,7 +39,10 @@ struct bpf_program {
 	((x)->blk_cnt * sizeof(*((x)->blks)))
 
 int gen_bpf_generate(const struct db_filter_col *col,
-		     struct bpf_program **prgm_ptr);
+		     struct bpf_program **prgm_ptr,
+		     struct db_filter_stats *stats);
+int gen_bpf_minimize(const struct db_filter_col *col,
+		     struct bpf_program *prgm, struct db_filter_stats *stats);
 void gen_bpf_release(struct bpf_program *program);
 
 #endif
@@ -21,6 +21,7 @@
 
 #include <errno.h>
 #include <inttypes.h>
+#include <stdarg.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -39,10 +40,108 @@
 
 struct pfc_sys_list {
 	struct db_sys_list *sys;
-	struct pfc_sys_list *next;
+	unsigned int order;
 };
 
-/* XXX - we should check the fprintf() return values */
+/* growable output buffer for the generated pfc */
+struct pfc_str {
+	char *buf;
+	size_t len;
+	size_t size;
+	int err;
+	/* allocate with realloc(3) as the buffer is returned to the caller */
+	bool raw;
+};
+
+#define PFC_STR_INIT_SIZE		4096
+
+/**
+ * Make room in the output buffer
+ * @param out the output buffer
+ * @param len the number of bytes needed, not including the nul terminator
+ *
+ * Grow the output buffer so that at least @len more bytes, plus a nul
+ * terminator, may be added.  Returns zero on success, negative values on
+ * failure; failures are also recorded in the output buffer.
+ *
+ */
+static int _pfc_grow(struct pfc_str *out, size_t len)
+{
+	size_t size;
+	char *buf;
+
+	if (out->err < 0)
+		return out->err;
+	if (out->size - out->len > len)
+		return 0;
+
+	size = (out->size > 0 ? out->size : PFC_STR_INIT_SIZE);
+	while (size - out->len <= len) {
+		if (size > SIZE_MAX / 2) {
+			out->err = -ENOMEM;
+			return out->err;
+		}
+		size *= 2;
+	}
+	if (out->raw)
+		buf = realloc(out->buf, size);
+	else
+		buf = zrealloc(out->buf, out->size, size);
+	if (buf == NULL) {
+		out->err = -ENOMEM;
+		return out->err;
+	}
+	out->buf = buf;
+	out->size = size;
+
+	return 0;
+}
+
+/**
+ * Append a string to the output buffer
+ * @param out the output buffer
+ * @param str the string
+ */
+static void _pfc_puts(struct pfc_str *out, const char *str)
+{
+	size_t len = strlen(str);
+
+	if (_pfc_grow(out, len) < 0)
+		return;
+	memcpy(out->buf + out->len, str, len + 1);
+	out->len += len;
+}
+
+/**
+ * Append a formatted string to the output buffer
+ * @param out the output buffer
+ * @param fmt the printf(3) format string
+ */
+__attribute__((format(printf, 2, 3)))
+static void _pfc_printf(struct pfc_str *out, const char *fmt, ...)
+{
+	int len;
+	va_list args;
+
+	if (_pfc_grow(out, 0) < 0)
+		return;
+
+	va_start(args, fmt);
+	len = vsnprintf(out->buf + out->len, out->size - out->len, fmt, args);
+	va_end(args);
+	if (len < 0) {
+		out->err = -EINVAL;
+		return;
+	}
+	if ((size_t)len >= out->size - out->len) {
+		if (_pfc_grow(out, len) < 0)
+			return;
+		va_start(args, fmt);
+		vsnprintf(out->buf + out->len, out->size - out->len, fmt, args);
+		va_end(args);
+	}
+	out->len += len;
+}
 
 /**
  * Display a string representation of the architecture
@@ -104,69 +203,72 @@ static const char *_pfc_arch(const struct arch_def *arch)
 
 /**
  * Display a string representation of the node argument
- * @param fds the file stream to send the output
+ * @param out the output buffer
  * @param arch the architecture definition
  * @param node the node
  */
-static void _pfc_arg(FILE *fds,
+static void _pfc_arg(struct pfc_str *out,
 		     const struct arch_def *arch,
 		     const struct db_arg_chain_tree *node)
 {
 	if (arch->size == ARCH_SIZE_64) {
 		if (arch_arg_offset_hi(arch, node->arg) == node->arg_offset)
-			fprintf(fds, "$a%d.hi32", node->arg);
+			_pfc_printf(out, "$a%d.hi32", node->arg);
 		else
-			fprintf(fds, "$a%d.lo32", node->arg);
+			_pfc_printf(out, "$a%d.lo32", node->arg);
 	} else
-		fprintf(fds, "$a%d", node->arg);
+		_pfc_printf(out, "$a%d", node->arg);
 }
 
 /**
  * Display a string representation of the filter action
- * @param fds the file stream to send the output
+ * @param out the output buffer
  * @param action the action
  */
-static void _pfc_action(FILE *fds, uint32_t action)
+static void _pfc_action(struct pfc_str *out, uint32_t action)
 {
 	switch (action & SECCOMP_RET_ACTION_FULL) {
 	case SCMP_ACT_KILL_PROCESS:
-		fprintf(fds, "action KILL_PROCESS;\n");
+		_pfc_puts(out, "action KILL_PROCESS;\n");
 		break;
 	case SCMP_ACT_KILL_THREAD:
-		fprintf(fds, "action KILL;\n");
+		_pfc_puts(out, "action KILL;\n");
 		break;
 	case SCMP_ACT_TRAP:
-		fprintf(fds, "action TRAP;\n");
+		_pfc_puts(out, "action TRAP;\n");
 		break;
 	case SCMP_ACT_ERRNO(0):
-		fprintf(fds, "action ERRNO(%u);\n", (action & 0x0000ffff));
+		_pfc_printf(out, "action ERRNO(%u);\n", (action & 0x0000ffff));
 		break;
 	case SCMP_ACT_TRACE(0):
-		fprintf(fds, "action TRACE(%u);\n", (action & 0x0000ffff));
+		_pfc_printf(out, "action TRACE(%u);\n", (action & 0x0000ffff));
 		break;
 	case SCMP_ACT_LOG:
-		fprintf(fds, "action LOG;\n");
+		_pfc_puts(out, "action LOG;\n");
 		break;
 	case SCMP_ACT_ALLOW:
-		fprintf(fds, "action ALLOW;\n");
+		_pfc_puts(out, "action ALLOW;\n");
 		break;
 	default:
-		fprintf(fds, "action 0x%x;\n", action);
+		_pfc_printf(out, "action 0x%x;\n", action);
 	}
 }
 
 /**
- * Indent the output stream
- * @param fds the file stream to send the output
+ * Indent the output buffer
+ * @param out the output buffer
  * @param lvl the indentation level
  *
- * This function indents the output stream with whitespace based on the
+ * This function indents the output buffer with whitespace based on the
  * requested indentation level.
  */
-static void _indent(FILE *fds, unsigned int lvl)
+static void _indent(struct pfc_str *out, unsigned int lvl)
 {
-	while (lvl-- > 0)
-		fprintf(fds, "  ");
+	if (_pfc_grow(out, lvl * 2) < 0)
+		return;
+	memset(out->buf + out->len, ' ', lvl * 2);
+	out->len += lvl * 2;
+	out->buf[out->len] = '\0';
 }
 
 /**
@@ -174,7 +276,7 @@ static void _indent(FILE *fds, unsigned int lvl)
  * @param arch the architecture definition
  * @param node the head of the argument chain
  * @param lvl the indentation level
- * @param fds the file stream to send the output
+ * @param out the output buffer
  *
  * This function generates the pseudo filter code representation of the given
  * argument chain and writes it to the given output stream.
@@ -182,7 +284,7 @@ static void _indent(FILE *fds, unsigned int lvl)
  */
 static void _gen_pfc_chain(const struct arch_def *arch,
 			   const struct db_arg_chain_tree *node,
-			   unsigned int lvl, FILE *fds)
+			   unsigned int lvl, struct pfc_str *out)
 {
 	const struct db_arg_chain_tree *c_iter;
 
@@ -193,47 +295,47 @@ static void _gen_pfc_chain(const struct arch_def *arch,
 
 	while (c_iter != NULL) {
 		/* comparison operation */
-		_indent(fds, lvl);
-		fprintf(fds, "if (");
-		_pfc_arg(fds, arch, c_iter);
+		_indent(out, lvl);
+		_pfc_puts(out, "if (");
+		_pfc_arg(out, arch, c_iter);
 		switch (c_iter->op) {
 		case SCMP_CMP_EQ:
-			fprintf(fds, " == ");
+			_pfc_puts(out, " == ");
 			break;
 		case SCMP_CMP_GE:
-			fprintf(fds, " >= ");
+			_pfc_puts(out, " >= ");
 			break;
 		case SCMP_CMP_GT:
-			fprintf(fds, " > ");
+			_pfc_puts(out, " > ");
 			break;
 		case SCMP_CMP_MASKED_EQ:
-			fprintf(fds, " & 0x%.8x == ", c_iter->mask);
+			_pfc_printf(out, " & 0x%.8x == ", c_iter->mask);
 			break;
 		case SCMP_CMP_NE:
 		case SCMP_CMP_LT:
 		case SCMP_CMP_LE:
 		default:
-			fprintf(fds, " ??? ");
+			_pfc_puts(out, " ??? ");
 		}
-		fprintf(fds, "%u)\n", c_iter->datum);
+		_pfc_printf(out, "%u)\n", c_iter->datum);
 
 		/* true result */
 		if (c_iter->act_t_flg) {
-			_indent(fds, lvl + 1);
-			_pfc_action(fds, c_iter->act_t);
+			_indent(out, lvl + 1);
+			_pfc_action(out, c_iter->act_t);
 		} else if (c_iter->nxt_t != NULL)
-			_gen_pfc_chain(arch, c_iter->nxt_t, lvl + 1, fds);
+			_gen_pfc_chain(arch, c_iter->nxt_t, lvl + 1, out);
 
 		/* false result */
 		if (c_iter->act_f_flg) {
-			_indent(fds, lvl);
-			fprintf(fds, "else\n");
-			_indent(fds, lvl + 1);
-			_pfc_action(fds, c_iter->act_f);
+			_indent(out, lvl);
+			_pfc_puts(out, "else\n");
+			_indent(out, lvl + 1);
+			_pfc_action(out, c_iter->act_f);
 		} else if (c_iter->nxt_f != NULL) {
-			_indent(fds, lvl);
-			fprintf(fds, "else\n");
-			_gen_pfc_chain(arch, c_iter->nxt_f, lvl + 1, fds);
+			_indent(out, lvl);
+			_pfc_puts(out, "else\n");
+			_gen_pfc_chain(arch, c_iter->nxt_f, lvl + 1, out);
 		}
 
 		c_iter = c_iter->lvl_nxt;
@@ -244,29 +346,29 @@ static void _gen_pfc_chain(const struct arch_def *arch,
  * Generate pseudo filter code for a syscall
  * @param arch the architecture definition
  * @param sys the syscall filter
- * @param fds the file stream to send the output
+ * @param out the output buffer
  *
  * This function generates a pseudo filter code representation of the given
  * syscall filter and writes it to the given output stream.
  *
  */
 static void _gen_pfc_syscall(const struct arch_def *arch,
-			     const struct db_sys_list *sys, FILE *fds,
+			     const struct db_sys_list *sys, struct pfc_str *out,
 			     int lvl)
 {
 	unsigned int sys_num = sys->num;
 	const char *sys_name = arch_syscall_resolve_num(arch, sys_num);
 
-	_indent(fds, lvl);
-	fprintf(fds, "# filter for syscall \"%s\" (%u) [priority: %d]\n",
+	_indent(out, lvl);
+	_pfc_printf(out, "# filter for syscall \"%s\" (%u) [priority: %d]\n",
 		(sys_name ? sys_name : "UNKNOWN"), sys_num, sys->priority);
-	_indent(fds, lvl);
-	fprintf(fds, "if ($syscall == %u)\n", sys_num);
+	_indent(out, lvl);
+	_pfc_printf(out, "if ($syscall == %u)\n", sys_num);
 	if (sys->chains == NULL) {
-		_indent(fds, lvl + 1);
-		_pfc_action(fds, sys->action);
+		_indent(out, lvl + 1);
+		_pfc_action(out, sys->action);
 	} else
-		_gen_pfc_chain(arch, sys->chains, lvl + 1, fds);
+		_gen_pfc_chain(arch, sys->chains, lvl + 1, out);
 }
 
 #define SYSCALLS_PER_NODE		(4)
@@ -290,142 +392,162 @@ static int _get_bintree_levels(unsigned int syscall_cnt,
 	return i;
 }
 
-static int _get_bintree_syscall_num(const struct pfc_sys_list *cur,
+static int _get_bintree_syscall_num(const struct pfc_sys_list *list,
+				    unsigned int cnt, unsigned int cur,
 				    int lookahead_cnt,
 				    int *const num)
 {
-	while (lookahead_cnt > 0 && cur != NULL) {
-		cur = cur->next;
-		lookahead_cnt--;
-	}
-
-	if (cur == NULL)
+	if (cur + lookahead_cnt >= cnt)
 		return -EFAULT;
 
-	*num = cur->sys->num;
+	*num = list[cur + lookahead_cnt].sys->num;
 	return 0;
 }
 
-static int _sys_num_sort(struct db_sys_list *syscalls,
-			 struct pfc_sys_list **p_head)
+/**
+ * Compare two syscalls by syscall number
+ * @param a the first syscall
+ * @param b the second syscall
+ *
+ * This is a qsort(3) comparison function which sorts the syscalls by syscall
+ * number, highest first.
+ *
+ */
+static int _sys_num_cmp(const void *a, const void *b)
 {
-	struct pfc_sys_list *p_iter = NULL, *p_new, *p_prev;
-	struct db_sys_list *s_iter;
+	const struct pfc_sys_list *s_a = a, *s_b = b;
 
-	db_list_foreach(s_iter, syscalls) {
-		p_new = zmalloc(sizeof(*p_new));
-		if (p_new == NULL) {
-			return -ENOMEM;
-		}
-		p_new->sys = s_iter;
-
-		p_prev = NULL;
-		p_iter = *p_head;
-		while (p_iter != NULL &&
-		       s_iter->num < p_iter->sys->num) {
-			p_prev = p_iter;
-			p_iter = p_iter->next;
-		}
-		if (*p_head == NULL)
-			*p_head = p_new;
-		else if (p_prev == NULL) {
-			p_new->next = *p_head;
-			*p_head = p_new;
-		} else {
-			p_new->next = p_iter;
-			p_prev->next = p_new;
-		}
-	}
-
-	return 0;
+	if (s_a->sys->num != s_b->sys->num)
+		return (s_a->sys->num > s_b->sys->num ? -1 : 1);
+	return (s_a->order > s_b->order ? -1 : 1);
 }
 
-static int _sys_priority_sort(struct db_sys_list *syscalls,
-			      struct pfc_sys_list **p_head)
+/**
+ * Compare two syscalls by priority
+ * @param a the first syscall
+ * @param b the second syscall
+ *
+ * This is a qsort(3) comparison function which sorts the syscalls by priority,
+ * highest first; syscalls with the same priority are sorted in the reverse of
+ * their order in the filter DB.
+ *
+ */
+static int _sys_priority_cmp(const void *a, const void *b)
 {
-	struct pfc_sys_list *p_iter = NULL, *p_new, *p_prev;
-	struct db_sys_list *s_iter;
+	const struct pfc_sys_list *s_a = a, *s_b = b;
 
-	db_list_foreach(s_iter, syscalls) {
-		p_new = zmalloc(sizeof(*p_new));
-		if (p_new == NULL) {
-			return -ENOMEM;
-		}
-		p_new->sys = s_iter;
-
-		p_prev = NULL;
-		p_iter = *p_head;
-		while (p_iter != NULL &&
-		       s_iter->priority < p_iter->sys->priority) {
-			p_prev = p_iter;
-			p_iter = p_iter->next;
-		}
-		if (*p_head == NULL)
-			*p_head = p_new;
-		else if (p_prev == NULL) {
-			p_new->next = *p_head;
-			*p_head = p_new;
-		} else {
-			p_new->next = p_iter;
-			p_prev->next = p_new;
-		}
-	}
+	if (s_a->sys->priority != s_b->sys->priority)
+		return (s_a->sys->priority > s_b->sys->priority ? -1 : 1);
+	return (s_a->order > s_b->order ? -1 : 1);
+}
 
-	return 0;
+/**
+ * Compare two syscalls by weight
+ * @param a the first syscall
+ * @param b the second syscall
+ *
+ * This is a qsort(3) comparison function which sorts the syscalls by weight,
+ * highest first; syscalls with the same weight are sorted by priority.
+ *
+ */
+static int _sys_weight_cmp(const void *a, const void *b)
+{
+	const struct pfc_sys_list *s_a = a, *s_b = b;
+
+	if (s_a->sys->weight != s_b->sys->weight)
+		return (s_a->sys->weight > s_b->sys->weight ? -1 : 1);
+	return _sys_priority_cmp(a, b);
 }
 
-static int _sys_sort(struct db_sys_list *syscalls,
-		     struct pfc_sys_list **p_head,
+/**
+ * Sort the syscalls
+ * @param db the seccomp filter
+ * @param list the sorted syscalls
+ * @param optimize the filter optimization level
+ *
+ * Sort the syscalls in the filter into a newly allocated array, the caller is
+ * responsible for freeing the array.  Returns the number of syscalls on
+ * success, negative values on failure.
+ *
+ */
+static int _sys_sort(const struct db_filter *db,
+		     struct pfc_sys_list **list,
 		     uint32_t optimize)
 {
-	if (optimize != 2)
-		return _sys_priority_sort(syscalls, p_head);
-	else
+	unsigned int cnt = 0;
+	struct db_sys_list *s_iter;
+	struct pfc_sys_list *l_new;
+
+	*list = NULL;
+	db_list_foreach(s_iter, db->syscalls)
+		cnt++;
+	if (cnt == 0)
+		return 0;
+
+	l_new = zmalloc(sizeof(*l_new) * cnt);
+	if (l_new == NULL)
+		return -ENOMEM;
+	cnt = 0;
+	db_list_foreach(s_iter, db->syscalls) {
+		l_new[cnt].sys = s_iter;
+		l_new[cnt].order = cnt;
+		cnt++;
+	}
+
+	if (optimize == 2)
 		/* sort by number for the binary tree */
-		return _sys_num_sort(syscalls, p_head);
+		qsort(l_new, cnt, sizeof(*l_new), _sys_num_cmp);
+	else if (optimize == 3)
+		qsort(l_new, cnt, sizeof(*l_new), _sys_weight_cmp);
+	else
+		qsort(l_new, cnt, sizeof(*l_new), _sys_priority_cmp);
+
+	*list = l_new;
+	return cnt;
 }
 
 /**
  * Generate pseudo filter code for an architecture
  * @param col the seccomp filter collection
  * @param db the single seccomp filter
- * @param fds the file stream to send the output
+ * @param out the output buffer
  *
  * This function generates a pseudo filter code representation of the given
- * filter DB and writes it to the given output stream.  Returns zero on
+ * filter DB and writes it to the given output buffer.  Returns zero on
  * success, negative values on failure.
  *
  */
 static int _gen_pfc_arch(const struct db_filter_col *col,
-			 const struct db_filter *db, FILE *fds,
+			 const struct db_filter *db, struct pfc_str *out,
 			 uint32_t optimize)
 {
 	int rc = 0, i = 0, lookahead_num;
 	unsigned int syscall_cnt = 0, bintree_levels, level, indent = 1;
-	struct pfc_sys_list *p_iter = NULL, *p_head = NULL;
+	unsigned int iter, list_cnt;
+	struct pfc_sys_list *list = NULL;
 
 	/* sort the syscall list */
-	rc = _sys_sort(db->syscalls, &p_head, optimize);
+	rc = _sys_sort(db, &list, optimize);
 	if (rc < 0)
-		goto arch_return;
+		return rc;
+	list_cnt = rc;
+	rc = 0;
 
 	bintree_levels = _get_bintree_levels(db->syscall_cnt, optimize);
 
-	fprintf(fds, "# filter for arch %s (%u)\n",
-		_pfc_arch(db->arch), db->arch->token_bpf);
-	fprintf(fds, "if ($arch == %u)\n", db->arch->token_bpf);
-	p_iter = p_head;
-	while (p_iter != NULL) {
-		if (!p_iter->sys->valid) {
-			p_iter = p_iter->next;
+	_pfc_printf(out, "# filter for arch %s (%u)\n",
+		    _pfc_arch(db->arch), db->arch->token_bpf);
+	_pfc_printf(out, "if ($arch == %u)\n", db->arch->token_bpf);
+	for (iter = 0; iter < list_cnt; iter++) {
+		if (!list[iter].sys->valid)
 			continue;
-		}
 
 		for (i = bintree_levels - 1; i > 0; i--) {
 			level = SYSCALLS_PER_NODE << i;
 
 			if (syscall_cnt == 0 || (syscall_cnt % level) == 0) {
-				rc = _get_bintree_syscall_num(p_iter, level / 2,
+				rc = _get_bintree_syscall_num(list, list_cnt,
+							      iter, level / 2,
 							      &lookahead_num);
 				if (rc < 0)
 					/* We have reached the end of the bintree.
@@ -433,21 +555,21 @@ static int _gen_pfc_arch(const struct db_filter_col *col,
 					 * any more if-elses.
 					 */
 					continue;
-				_indent(fds, indent);
-				fprintf(fds, "if ($syscall > %u)\n", lookahead_num);
+				_indent(out, indent);
+				_pfc_printf(out, "if ($syscall > %u)\n",
+					    lookahead_num);
 				indent++;
 			} else if ((syscall_cnt % (level / 2)) == 0) {
-				lookahead_num = p_iter->sys->num;
-				_indent(fds, indent - 1);
-				fprintf(fds, "else # ($syscall <= %u)\n",
-					p_iter->sys->num);
+				lookahead_num = list[iter].sys->num;
+				_indent(out, indent - 1);
+				_pfc_printf(out, "else # ($syscall <= %u)\n",
+					    list[iter].sys->num);
 			}
 
 		}
 
-		_gen_pfc_syscall(db->arch, p_iter->sys, fds, indent);
+		_gen_pfc_syscall(db->arch, list[iter].sys, out, indent);
 		syscall_cnt++;
-		p_iter = p_iter->next;
 
 		/* undo the indentations as the else statements complete */
 		for (i = 0; i < bintree_levels; i++) {
@@ -455,19 +577,51 @@ static int _gen_pfc_arch(const struct db_filter_col *col,
 				indent--;
 		}
 	}
-	_indent(fds, 1);
-	fprintf(fds, "# default action\n");
-	_indent(fds, 1);
-	_pfc_action(fds, col->attr.act_default);
-
-arch_return:
-	while (p_head != NULL) {
-		p_iter = p_head;
-		p_head = p_head->next;
-		free(p_iter);
+	_indent(out, 1);
+	_pfc_puts(out, "# default action\n");
+	_indent(out, 1);
+	_pfc_action(out, col->attr.act_default);
+
+	zfree(list);
+	return out->err;
+}
+
+/**
+ * Generate a pseudo filter code string representation
+ * @param col the seccomp filter collection
+ * @param out the output buffer
+ *
+ * This function generates a pseudo filter code representation of the given
+ * filter collection and writes it to the given output buffer.  Returns zero on
+ * success, negative errno values on failure.
+ *
+ */
+static int _gen_pfc(const struct db_filter_col *col, struct pfc_str *out)
+{
+	int rc;
+	unsigned int iter;
+
+	/* generate the pfc */
+	_pfc_puts(out, "#\n");
+	_pfc_puts(out, "# pseudo filter code start\n");
+	_pfc_puts(out, "#\n");
+
+	for (iter = 0; iter < col->filter_cnt; iter++) {
+		rc = _gen_pfc_arch(col, col->filters[iter], out,
+				   col->attr.optimize);
+		if (rc < 0)
+			return rc;
 	}
-	return rc;
+
+	_pfc_puts(out, "# invalid architecture action\n");
+	_pfc_action(out, col->attr.act_badarch);
+	_pfc_puts(out, "#\n");
+	_pfc_puts(out, "# pseudo filter code end\n");
+	_pfc_puts(out, "#\n");
+
+	return out->err;
 }
+
 /**
  * Generate a pseudo filter code string representation
  * @param col the seccomp filter collection
@@ -480,36 +634,73 @@ arch_return:
  */
 int gen_pfc_generate(const struct db_filter_col *col, int fd)
 {
-	int newfd;
-	unsigned int iter;
-	FILE *fds;
-
-	newfd = dup(fd);
-	if (newfd < 0)
-		return -errno;
-	fds = fdopen(newfd, "a");
-	if (fds == NULL) {
-		close(newfd);
-		return -errno;
-	}
+	int rc;
+	ssize_t len;
+	size_t off = 0;
+	struct pfc_str out = { 0 };
 
-	/* generate the pfc */
-	fprintf(fds, "#\n");
-	fprintf(fds, "# pseudo filter code start\n");
-	fprintf(fds, "#\n");
+	rc = _gen_pfc(col, &out);
+	if (rc < 0)
+		goto generate_return;
+
+	while (off < out.len) {
+		len = write(fd, out.buf + off, out.len - off);
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			rc = -errno;
+			goto generate_return;
+		}
+		off += len;
+	}
 
-	for (iter = 0; iter < col->filter_cnt; iter++)
-		_gen_pfc_arch(col, col->filters[iter], fds,
-			      col->attr.optimize);
+generate_return:
+	zfree(out.buf);
+	return rc;
+}
 
-	fprintf(fds, "# invalid architecture action\n");
-	_pfc_action(fds, col->attr.act_badarch);
-	fprintf(fds, "#\n");
-	fprintf(fds, "# pseudo filter code end\n");
-	fprintf(fds, "#\n");
+/**
+ * Generate a pseudo filter code string representation in memory
+ * @param col the seccomp filter collection
+ * @param buf the destination buffer
+ * @param len the destination buffer length
+ *
+ * This function generates a pseudo filter code representation of the given
+ * filter collection and writes it, as a nul terminated string, to the given
+ * buffer.  If @buf points to NULL a buffer is allocated with malloc(3) and
+ * returned to the caller, otherwise @len is the size of the caller's buffer.
+ * On success @len is set to the length of the string, if the caller's buffer
+ * is too small @len is set to the size of the buffer required.  Returns zero
+ * on success, negative errno values on failure.
+ *
+ */
+int gen_pfc_generate_mem(const struct db_filter_col *col,
+			 char **buf, size_t *len)
+{
+	int rc;
+	struct pfc_str out = { 0 };
 
-	fflush(fds);
-	fclose(fds);
+	/* render directly into the returned buffer if we are allocating it */
+	out.raw = (*buf == NULL);
+	rc = _gen_pfc(col, &out);
+	if (rc < 0)
+		goto generate_return;
+
+	if (out.raw) {
+		*buf = out.buf;
+		out.buf = NULL;
+	} else if (*len < out.len + 1) {
+		*len = out.len + 1;
+		rc = -ERANGE;
+		goto generate_return;
+	} else
+		memcpy(*buf, out.buf, out.len + 1);
+	*len = out.len;
 
-	return 0;
+generate_return:
+	if (out.raw)
+		free(out.buf);
+	else
+		zfree(out.buf);
+	return rc;
 }
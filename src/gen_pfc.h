@@ -25,5 +25,7 @@
 #include "db.h"
 
 int gen_pfc_generate(const struct db_filter_col *col, int fd);
+int gen_pfc_generate_mem(const struct db_filter_col *col,
+			 char **buf, size_t *len);
 
 #endif
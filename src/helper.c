@@ -19,26 +19,245 @@
  * along with this library; if not, see <http://www.gnu.org/licenses>.
  */
 
+#include <errno.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "helper.h"
 
+/* memory allocator */
+struct zalloc {
+	struct scmp_allocator ops;
+	struct zalloc *next;
+};
+
+/* allocation header, sized to preserve the alignment of the buffer */
+union zhdr {
+	struct {
+		size_t size;
+		/* the allocator, NULL for the C library */
+		const struct zalloc *alloc;
+	} z;
+	long double align_ld;
+	uint64_t align_u64;
+	void *align_ptr;
+};
+
+/* memory accounting target for the current thread */
+static __thread struct mem_acct *zacct = NULL;
+
+/* process-wide allocator, NULL for the C library */
+static const struct zalloc *zalloc_proc = NULL;
+/* all of the process-wide allocators, these are never released */
+static struct zalloc *zalloc_proc_list = NULL;
+
+/**
+ * Set the memory accounting target for the current thread
+ * @param acct the new accounting target, NULL to disable accounting
+ *
+ * This function sets the accounting target which is charged for all of the
+ * memory allocated and released by the current thread through zmalloc(),
+ * zrealloc() and zfree().  If the target has a non-zero limit, allocations
+ * that would exceed the limit fail.  Returns the previous accounting target
+ * which should be restored by the caller when it is done.
+ *
+ */
+struct mem_acct *mem_acct_swap(struct mem_acct *acct)
+{
+	struct mem_acct *prev = zacct;
+
+	zacct = acct;
+	return prev;
+}
+
+/**
+ * Find an allocator in a list of allocators
+ * @param list the list of allocators
+ * @param alloc the allocator
+ *
+ * Returns the matching allocator from the list, NULL if it is not found.
+ *
+ */
+static struct zalloc *_zalloc_find(struct zalloc *list,
+				   const struct scmp_allocator *alloc)
+{
+	struct zalloc *iter;
+
+	for (iter = list; iter != NULL; iter = iter->next) {
+		if (iter->ops.malloc_fn == alloc->malloc_fn &&
+		    iter->ops.realloc_fn == alloc->realloc_fn &&
+		    iter->ops.free_fn == alloc->free_fn &&
+		    iter->ops.data == alloc->data)
+			return iter;
+	}
+
+	return NULL;
+}
+
+/**
+ * Set the allocator for an accounting target
+ * @param acct the accounting target, NULL for the process-wide allocator
+ * @param alloc the allocator, NULL for the C library allocator
+ *
+ * This function sets the allocator used for all new memory allocated while
+ * @acct is the current accounting target or, if @acct is NULL, for all new
+ * memory allocated when the current accounting target does not have its own
+ * allocator.  Memory is always released, or resized, with the allocator which
+ * allocated it, so the allocators are kept until the accounting target is
+ * released with mem_acct_alloc_release(); the process-wide allocators are
+ * never released.  Returns zero on success, negative values on failure.
+ *
+ */
+int mem_acct_alloc_set(struct mem_acct *acct,
+		       const struct scmp_allocator *alloc)
+{
+	struct zalloc **list;
+	struct zalloc *za = NULL;
+
+	list = (acct != NULL ? &acct->alloc_list : &zalloc_proc_list);
+	if (alloc != NULL) {
+		if (alloc->malloc_fn == NULL || alloc->realloc_fn == NULL ||
+		    alloc->free_fn == NULL)
+			return -EINVAL;
+
+		za = _zalloc_find(*list, alloc);
+		if (za == NULL) {
+			/* NOTE: the allocators can't be allocated with
+			 *       zmalloc() as they must outlive the memory which
+			 *       was allocated through them */
+			za = malloc(sizeof(*za));
+			if (za == NULL)
+				return -ENOMEM;
+			za->ops = *alloc;
+			za->next = *list;
+			*list = za;
+		}
+	}
+
+	if (acct != NULL)
+		acct->alloc = za;
+	else
+		zalloc_proc = za;
+
+	return 0;
+}
+
+/**
+ * Transfer the allocators from one accounting target to another
+ * @param dst the destination accounting target
+ * @param src the source accounting target
+ *
+ * This function moves the allocators from @src to @dst so that the memory
+ * allocated while @src was the accounting target can be safely transferred to
+ * @dst.  The current allocator of @dst is not changed.
+ *
+ */
+void mem_acct_alloc_move(struct mem_acct *dst, struct mem_acct *src)
+{
+	struct zalloc **tail;
+
+	tail = &dst->alloc_list;
+	while (*tail != NULL)
+		tail = &(*tail)->next;
+	*tail = src->alloc_list;
+
+	src->alloc = NULL;
+	src->alloc_list = NULL;
+}
+
+/**
+ * Release the allocators of an accounting target
+ * @param acct the accounting target
+ *
+ * This function releases the allocators of the given accounting target, it
+ * must only be called once all of the memory allocated while @acct was the
+ * accounting target has been released.
+ *
+ */
+void mem_acct_alloc_release(struct mem_acct *acct)
+{
+	struct zalloc *za;
+
+	while (acct->alloc_list != NULL) {
+		za = acct->alloc_list;
+		acct->alloc_list = za->next;
+		free(za);
+	}
+	acct->alloc = NULL;
+}
+
+/**
+ * Charge an allocation to the current accounting target
+ * @param size the number of bytes
+ *
+ * Returns zero on success, negative values if the allocation would exceed the
+ * limit.
+ *
+ */
+static int _zcharge(size_t size)
+{
+	if (zacct == NULL)
+		return 0;
+
+	if (zacct->limit > 0 &&
+	    (size > zacct->limit || zacct->used > zacct->limit - size))
+		return -1;
+	zacct->used += size;
+	return 0;
+}
+
+/**
+ * Credit a release to the current accounting target
+ * @param size the number of bytes
+ *
+ */
+static void _zcredit(size_t size)
+{
+	if (zacct == NULL)
+		return;
+
+	zacct->used = (zacct->used > size ? zacct->used - size : 0);
+}
+
 /**
  * Allocate memory
  * @param size the size of the buffer to allocate
  *
  * This function allocates a buffer of the given size, initializes it to zero,
  * and returns a pointer to buffer on success.  NULL is returned on failure.
+ * Buffers allocated with this function must be released with zfree().
  *
  */
 void *zmalloc(size_t size)
 {
+	union zhdr *hdr;
+	const struct zalloc *alloc;
+
 	/* NOTE: unlike malloc() zero size allocations always return NULL */
-	if (size == 0)
+	if (size == 0 || size > SIZE_MAX - sizeof(*hdr))
+		return NULL;
+
+	if (_zcharge(sizeof(*hdr) + size) < 0)
 		return NULL;
+	alloc = (zacct != NULL && zacct->alloc != NULL ?
+		 zacct->alloc : zalloc_proc);
+	if (alloc == NULL)
+		hdr = calloc(1, sizeof(*hdr) + size);
+	else {
+		hdr = alloc->ops.malloc_fn(sizeof(*hdr) + size,
+					   alloc->ops.data);
+		if (hdr != NULL)
+			memset(hdr, 0, sizeof(*hdr) + size);
+	}
+	if (hdr == NULL) {
+		_zcredit(sizeof(*hdr) + size);
+		return NULL;
+	}
+	hdr->z.size = size;
+	hdr->z.alloc = alloc;
 
-	return calloc(1, size);
+	return hdr + 1;
 }
 
 /**
@@ -55,13 +274,78 @@ void *zmalloc(size_t size)
  */
 void *zrealloc(void *ptr, size_t old_size, size_t size)
 {
+	union zhdr *hdr;
+	size_t cur;
+	const struct zalloc *alloc;
+
 	/* NOTE: unlike malloc() zero size allocations always return NULL */
-	if (size == 0)
+	if (size == 0 || size > SIZE_MAX - sizeof(*hdr))
 		return NULL;
+	if (ptr == NULL)
+		return zmalloc(size);
 
-	ptr = realloc(ptr, size);
-	if (!ptr)
+	hdr = (union zhdr *)ptr - 1;
+	cur = hdr->z.size;
+	alloc = hdr->z.alloc;
+	if (size > cur && _zcharge(size - cur) < 0)
+		return NULL;
+	if (alloc == NULL)
+		hdr = realloc(hdr, sizeof(*hdr) + size);
+	else
+		hdr = alloc->ops.realloc_fn(hdr, sizeof(*hdr) + size,
+					    alloc->ops.data);
+	if (hdr == NULL) {
+		if (size > cur)
+			_zcredit(size - cur);
 		return NULL;
-	memset(ptr + old_size, 0, size - old_size);
+	}
+	if (size < cur)
+		_zcredit(cur - size);
+	hdr->z.size = size;
+
+	ptr = hdr + 1;
+	if (size > old_size)
+		memset((char *)ptr + old_size, 0, size - old_size);
 	return ptr;
 }
+
+/**
+ * Free an allocated buffer
+ * @param ptr pointer to the allocated buffer, may be NULL
+ *
+ * This function releases a buffer allocated by zmalloc() or zrealloc().
+ *
+ */
+void zfree(void *ptr)
+{
+	union zhdr *hdr;
+
+	if (ptr == NULL)
+		return;
+
+	hdr = (union zhdr *)ptr - 1;
+	_zcredit(sizeof(*hdr) + hdr->z.size);
+	if (hdr->z.alloc == NULL)
+		free(hdr);
+	else
+		hdr->z.alloc->ops.free_fn(hdr, hdr->z.alloc->ops.data);
+}
+
+/**
+ * Return the accounted size of an allocated buffer
+ * @param ptr pointer to the allocated buffer
+ *
+ * This function returns the number of bytes charged for a buffer allocated by
+ * zmalloc() or zrealloc(), including the allocator's own overhead.
+ *
+ */
+size_t zsize(const void *ptr)
+{
+	const union zhdr *hdr;
+
+	if (ptr == NULL)
+		return 0;
+
+	hdr = (const union zhdr *)ptr - 1;
+	return sizeof(*hdr) + hdr->z.size;
+}
@@ -22,7 +22,32 @@
 #ifndef _FILTER_HELPER_H
 #define _FILTER_HELPER_H
 
+#include <stddef.h>
+
+#include <seccomp.h>
+
+struct zalloc;
+
+struct mem_acct {
+	/* bytes currently allocated */
+	size_t used;
+	/* maximum number of bytes which may be allocated, zero if unlimited */
+	size_t limit;
+	/* allocator for new memory, NULL to use the process-wide allocator */
+	const struct zalloc *alloc;
+	/* allocators used by this target, see mem_acct_alloc_release() */
+	struct zalloc *alloc_list;
+};
+
+struct mem_acct *mem_acct_swap(struct mem_acct *acct);
+int mem_acct_alloc_set(struct mem_acct *acct,
+		       const struct scmp_allocator *alloc);
+void mem_acct_alloc_move(struct mem_acct *dst, struct mem_acct *src);
+void mem_acct_alloc_release(struct mem_acct *acct);
+
 void *zmalloc(size_t size);
 void *zrealloc(void *ptr, size_t old_size, size_t size);
+void zfree(void *ptr);
+size_t zsize(const void *ptr);
 
 #endif
@@ -0,0 +1,1331 @@
+/**
+ * Seccomp OCI Profile Loader
+ *
+ * Copyright (c) 2026 Microsoft Corporation <paulmoore@microsoft.com>
+ * Author: Paul Moore <paul@paul-moore.com>
+ */
+
+/*
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of version 2.1 of the GNU Lesser General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses>.
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/utsname.h>
+
+#include <seccomp.h>
+
+#include "arch.h"
+#include "db.h"
+#include "helper.h"
+#include "oci.h"
+
+/* longest string value we interpret, longer strings never match anything */
+#define OCI_STR_MAX		64
+/* deepest nesting of JSON objects and arrays we accept */
+#define OCI_DEPTH_MAX		32
+/* most architectures a profile can list */
+#define OCI_ARCH_MAX		32
+/* initial size of the fd read buffer */
+#define OCI_READ_SIZE		4096
+
+struct oci_parser {
+	const char *buf;
+	size_t len;
+	size_t pos;
+	unsigned int depth;
+};
+
+struct oci_rule {
+	uint32_t action;
+	int syscall;
+	unsigned int arg_off;
+	unsigned int arg_cnt;
+};
+
+struct oci_profile {
+	/* caller provided state */
+	uint64_t caps;
+
+	/* running kernel version, major/minor, zero if unknown */
+	unsigned int kver[2];
+
+	/* default action */
+	bool def_set;
+	uint32_t def_action;
+	bool def_errno_set;
+	uint32_t def_errno;
+
+	/* architectures from "architectures" and "archMap" */
+	uint32_t arches[OCI_ARCH_MAX];
+	unsigned int arch_cnt;
+	uint32_t arch_map[OCI_ARCH_MAX];
+	unsigned int arch_map_cnt;
+
+	/* filter flags, indexed by _oci_flags[] */
+	unsigned int flags;
+
+	/* rules and their argument comparisons */
+	struct oci_rule *rules;
+	unsigned int rule_cnt;
+	unsigned int rule_max;
+	struct scmp_arg_cmp *args;
+	unsigned int arg_cnt;
+	unsigned int arg_max;
+};
+
+struct oci_entry {
+	/* resolved syscalls */
+	int *sys;
+	unsigned int sys_cnt;
+	unsigned int sys_max;
+
+	/* action */
+	bool act_set;
+	uint32_t action;
+	bool errno_set;
+	uint32_t errno_ret;
+
+	/* argument comparisons, stored in the profile's argument list */
+	unsigned int arg_off;
+	unsigned int arg_cnt;
+
+	/* set if the includes/excludes conditions drop the entry */
+	bool skip;
+};
+
+struct oci_name_val {
+	const char *name;
+	uint32_t val;
+};
+
+static const struct oci_name_val _oci_actions[] = {
+	{ "SCMP_ACT_KILL", SCMP_ACT_KILL },
+	{ "SCMP_ACT_KILL_THREAD", SCMP_ACT_KILL_THREAD },
+	{ "SCMP_ACT_KILL_PROCESS", SCMP_ACT_KILL_PROCESS },
+	{ "SCMP_ACT_TRAP", SCMP_ACT_TRAP },
+	{ "SCMP_ACT_ERRNO", SCMP_ACT_ERRNO(0) },
+	{ "SCMP_ACT_TRACE", SCMP_ACT_TRACE(0) },
+	{ "SCMP_ACT_ALLOW", SCMP_ACT_ALLOW },
+	{ "SCMP_ACT_LOG", SCMP_ACT_LOG },
+	{ "SCMP_ACT_NOTIFY", SCMP_ACT_NOTIFY },
+	{ NULL, 0 },
+};
+
+static const struct oci_name_val _oci_ops[] = {
+	{ "SCMP_CMP_NE", SCMP_CMP_NE },
+	{ "SCMP_CMP_LT", SCMP_CMP_LT },
+	{ "SCMP_CMP_LE", SCMP_CMP_LE },
+	{ "SCMP_CMP_EQ", SCMP_CMP_EQ },
+	{ "SCMP_CMP_GE", SCMP_CMP_GE },
+	{ "SCMP_CMP_GT", SCMP_CMP_GT },
+	{ "SCMP_CMP_MASKED_EQ", SCMP_CMP_MASKED_EQ },
+	{ NULL, 0 },
+};
+
+static const struct oci_name_val _oci_flags[] = {
+	{ "SECCOMP_FILTER_FLAG_TSYNC", SCMP_FLTATR_CTL_TSYNC },
+	{ "SECCOMP_FILTER_FLAG_LOG", SCMP_FLTATR_CTL_LOG },
+	{ "SECCOMP_FILTER_FLAG_SPEC_ALLOW", SCMP_FLTATR_CTL_SSB },
+	{ "SECCOMP_FILTER_FLAG_WAIT_KILLABLE_RECV", SCMP_FLTATR_CTL_WAITKILL },
+	{ NULL, 0 },
+};
+
+/* architecture names as used by Go's GOARCH, e.g. in Docker profiles */
+static const struct oci_name_val _oci_goarch[] = {
+	{ "386", SCMP_ARCH_X86 },
+	{ "amd64", SCMP_ARCH_X86_64 },
+	{ "arm64", SCMP_ARCH_AARCH64 },
+	{ "loong64", SCMP_ARCH_LOONGARCH64 },
+	{ "mipsle", SCMP_ARCH_MIPSEL },
+	{ "mips64le", SCMP_ARCH_MIPSEL64 },
+	{ NULL, 0 },
+};
+
+/* capability names, indexed by capability number */
+static const char *_oci_caps[] = {
+	"CAP_CHOWN", "CAP_DAC_OVERRIDE", "CAP_DAC_READ_SEARCH", "CAP_FOWNER",
+	"CAP_FSETID", "CAP_KILL", "CAP_SETGID", "CAP_SETUID", "CAP_SETPCAP",
+	"CAP_LINUX_IMMUTABLE", "CAP_NET_BIND_SERVICE", "CAP_NET_BROADCAST",
+	"CAP_NET_ADMIN", "CAP_NET_RAW", "CAP_IPC_LOCK", "CAP_IPC_OWNER",
+	"CAP_SYS_MODULE", "CAP_SYS_RAWIO", "CAP_SYS_CHROOT", "CAP_SYS_PTRACE",
+	"CAP_SYS_PACCT", "CAP_SYS_ADMIN", "CAP_SYS_BOOT", "CAP_SYS_NICE",
+	"CAP_SYS_RESOURCE", "CAP_SYS_TIME", "CAP_SYS_TTY_CONFIG", "CAP_MKNOD",
+	"CAP_LEASE", "CAP_AUDIT_WRITE", "CAP_AUDIT_CONTROL", "CAP_SETFCAP",
+	"CAP_MAC_OVERRIDE", "CAP_MAC_ADMIN", "CAP_SYSLOG", "CAP_WAKE_ALARM",
+	"CAP_BLOCK_SUSPEND", "CAP_AUDIT_READ", "CAP_PERFMON", "CAP_BPF",
+	"CAP_CHECKPOINT_RESTORE",
+};
+
+/**
+ * Lookup a name in a name/value table
+ * @param table the table
+ * @param name the name
+ * @param val the value
+ *
+ * Search the given NULL terminated table for the given name.  Returns zero
+ * and sets @val if the name is found, negative values otherwise.
+ *
+ */
+static int _oci_lookup(const struct oci_name_val *table,
+		       const char *name, uint32_t *val)
+{
+	const struct oci_name_val *iter;
+
+	for (iter = table; iter->name != NULL; iter++) {
+		if (strcmp(iter->name, name) == 0) {
+			*val = iter->val;
+			return 0;
+		}
+	}
+	return -EINVAL;
+}
+
+/**
+ * Lookup an architecture by name
+ * @param name the architecture name
+ *
+ * Profiles name architectures either with the libseccomp constant, e.g.
+ * "SCMP_ARCH_X86_64", or in the "includes"/"excludes" conditions with either
+ * the libseccomp or the Go name, e.g. "x86_64" or "amd64".  Returns the
+ * architecture definition on success, NULL if the name is unknown.
+ *
+ */
+static const struct arch_def *_oci_arch_lookup(const char *name)
+{
+	char arch_name[OCI_STR_MAX];
+	unsigned int iter;
+	uint32_t token;
+
+	if (strncmp(name, "SCMP_ARCH_", 10) == 0)
+		name += 10;
+	for (iter = 0; name[iter] != '\0' && iter < OCI_STR_MAX - 1; iter++) {
+		if (name[iter] >= 'A' && name[iter] <= 'Z')
+			arch_name[iter] = name[iter] - 'A' + 'a';
+		else
+			arch_name[iter] = name[iter];
+	}
+	arch_name[iter] = '\0';
+
+	if (_oci_lookup(_oci_goarch, arch_name, &token) == 0)
+		return arch_def_lookup(token);
+	return arch_def_lookup_name(arch_name);
+}
+
+/**
+ * Grow an array
+ * @param array the array
+ * @param max the number of allocated elements
+ * @param cnt the number of used elements
+ * @param size the size of a single element
+ *
+ * Ensure there is room for at least one more element in the array, doubling
+ * its size if needed.  Returns zero on success, negative values on failure.
+ *
+ */
+static int _oci_grow(void **array, unsigned int *max,
+		     unsigned int cnt, size_t size)
+{
+	unsigned int max_new;
+	void *tmp;
+
+	if (cnt < *max)
+		return 0;
+
+	max_new = (*max > 0 ? *max * 2 : 16);
+	if (max_new <= *max)
+		return -ENOMEM;
+	tmp = zrealloc(*array, size * *max, size * max_new);
+	if (tmp == NULL)
+		return -ENOMEM;
+	*array = tmp;
+	*max = max_new;
+
+	return 0;
+}
+
+/**
+ * Skip any whitespace
+ * @param p the parser
+ *
+ * Advance the parser past any JSON whitespace.  Returns the next character or
+ * -1 if the end of the buffer has been reached.
+ *
+ */
+static int _oci_ws(struct oci_parser *p)
+{
+	while (p->pos < p->len) {
+		switch (p->buf[p->pos]) {
+		case ' ':
+		case '\t':
+		case '\n':
+		case '\r':
+			p->pos++;
+			break;
+		default:
+			return (unsigned char)p->buf[p->pos];
+		}
+	}
+	return -1;
+}
+
+/**
+ * Consume a literal
+ * @param p the parser
+ * @param lit the literal
+ *
+ * Consume the given literal, e.g. "null", from the buffer.  Returns zero on
+ * success, negative values on failure.
+ *
+ */
+static int _oci_literal(struct oci_parser *p, const char *lit)
+{
+	size_t len = strlen(lit);
+
+	if (p->len - p->pos < len || memcmp(&p->buf[p->pos], lit, len) != 0)
+		return -EINVAL;
+	p->pos += len;
+	return 0;
+}
+
+/**
+ * Parse a JSON string
+ * @param p the parser
+ * @param str the destination buffer, or NULL to discard the string
+ * @param str_len the size of the destination buffer
+ *
+ * Parse a JSON string, handling escapes.  Strings which do not fit in the
+ * destination buffer, or which contain non-ASCII or NUL characters, are
+ * returned as an empty string as they never match anything we look for.
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int _oci_string(struct oci_parser *p, char *str, size_t str_len)
+{
+	unsigned int iter;
+	unsigned int c;
+	unsigned int cp;
+	size_t len = 0;
+	bool bad = false;
+
+	if (_oci_ws(p) != '"')
+		return -EINVAL;
+	p->pos++;
+
+	while (p->pos < p->len) {
+		c = (unsigned char)p->buf[p->pos++];
+		if (c == '"') {
+			if (str != NULL)
+				str[(bad ? 0 : len)] = '\0';
+			return 0;
+		}
+		if (c < 0x20)
+			return -EINVAL;
+		if (c >= 0x80)
+			bad = true;
+		if (c == '\\') {
+			if (p->pos >= p->len)
+				return -EINVAL;
+			c = (unsigned char)p->buf[p->pos++];
+			switch (c) {
+			case '"':
+			case '\\':
+			case '/':
+				break;
+			case 'b':
+				c = '\b';
+				break;
+			case 'f':
+				c = '\f';
+				break;
+			case 'n':
+				c = '\n';
+				break;
+			case 'r':
+				c = '\r';
+				break;
+			case 't':
+				c = '\t';
+				break;
+			case 'u':
+				if (p->len - p->pos < 4)
+					return -EINVAL;
+				for (cp = 0, iter = 0; iter < 4; iter++) {
+					c = (unsigned char)p->buf[p->pos++];
+					cp <<= 4;
+					if (c >= '0' && c <= '9')
+						cp |= c - '0';
+					else if (c >= 'a' && c <= 'f')
+						cp |= c - 'a' + 10;
+					else if (c >= 'A' && c <= 'F')
+						cp |= c - 'A' + 10;
+					else
+						return -EINVAL;
+				}
+				if (cp == 0 || cp >= 0x80)
+					bad = true;
+				c = cp;
+				break;
+			default:
+				return -EINVAL;
+			}
+		}
+		if (str != NULL && !bad) {
+			if (len + 1 < str_len)
+				str[len++] = c;
+			else
+				bad = true;
+		}
+	}
+
+	return -EINVAL;
+}
+
+/**
+ * Parse a JSON integer
+ * @param p the parser
+ * @param val the absolute value of the integer
+ * @param neg set if the integer is negative
+ *
+ * Parse a JSON number, only integers which fit in 64 bits are accepted.
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int _oci_number(struct oci_parser *p, uint64_t *val, bool *neg)
+{
+	unsigned int digit;
+	size_t start;
+
+	*val = 0;
+	*neg = false;
+	if (_oci_ws(p) == '-') {
+		*neg = true;
+		p->pos++;
+	}
+
+	start = p->pos;
+	while (p->pos < p->len &&
+	       p->buf[p->pos] >= '0' && p->buf[p->pos] <= '9') {
+		digit = p->buf[p->pos++] - '0';
+		if (*val > (UINT64_MAX - digit) / 10)
+			return -EINVAL;
+		*val = *val * 10 + digit;
+	}
+	if (p->pos == start)
+		return -EINVAL;
+
+	/* fractions and exponents are never valid in a profile */
+	if (p->pos < p->len &&
+	    (p->buf[p->pos] == '.' ||
+	     p->buf[p->pos] == 'e' || p->buf[p->pos] == 'E'))
+		return -EINVAL;
+
+	return 0;
+}
+
+/**
+ * Parse an unsigned JSON integer
+ * @param p the parser
+ * @param max the largest acceptable value
+ * @param val the value
+ *
+ * Parse a non-negative JSON integer no larger than @max.  Returns zero on
+ * success, negative values on failure.
+ *
+ */
+static int _oci_uint(struct oci_parser *p, uint64_t max, uint64_t *val)
+{
+	int rc;
+	bool neg;
+
+	rc = _oci_number(p, val, &neg);
+	if (rc < 0)
+		return rc;
+	if (neg || *val > max)
+		return -EINVAL;
+	return 0;
+}
+
+/**
+ * Open a JSON object or array
+ * @param p the parser
+ * @param type either '{' or '['
+ *
+ * Consume the opening character of an object or array.  A JSON null is
+ * accepted in place of the object or array and treated as if it was empty.
+ * Returns one if an object or array was opened, zero if a null was consumed,
+ * and negative values on failure.
+ *
+ */
+static int _oci_open(struct oci_parser *p, char type)
+{
+	int c = _oci_ws(p);
+
+	if (c == 'n')
+		return _oci_literal(p, "null");
+	if (c != type)
+		return -EINVAL;
+	if (p->depth >= OCI_DEPTH_MAX)
+		return -EINVAL;
+	p->depth++;
+	p->pos++;
+	return 1;
+}
+
+/**
+ * Advance to the next member of a JSON object
+ * @param p the parser
+ * @param first the first member flag, set to true when opening the object
+ * @param key the destination buffer for the member name, or NULL
+ * @param key_len the size of the destination buffer
+ *
+ * Advance the parser to the value of the next member of the current object.
+ * Returns one if there is another member, zero at the end of the object, and
+ * negative values on failure.
+ *
+ */
+static int _oci_obj_next(struct oci_parser *p, bool *first,
+			 char *key, size_t key_len)
+{
+	int rc;
+	int c = _oci_ws(p);
+
+	if (c == '}') {
+		p->pos++;
+		p->depth--;
+		return 0;
+	}
+	if (!*first) {
+		if (c != ',')
+			return -EINVAL;
+		p->pos++;
+	}
+	*first = false;
+
+	rc = _oci_string(p, key, key_len);
+	if (rc < 0)
+		return rc;
+	if (_oci_ws(p) != ':')
+		return -EINVAL;
+	p->pos++;
+
+	return 1;
+}
+
+/**
+ * Advance to the next element of a JSON array
+ * @param p the parser
+ * @param first the first element flag, set to true when opening the array
+ *
+ * Advance the parser to the next element of the current array.  Returns one
+ * if there is another element, zero at the end of the array, and negative
+ * values on failure.
+ *
+ */
+static int _oci_arr_next(struct oci_parser *p, bool *first)
+{
+	int c = _oci_ws(p);
+
+	if (c == ']') {
+		p->pos++;
+		p->depth--;
+		return 0;
+	}
+	if (!*first) {
+		if (c != ',')
+			return -EINVAL;
+		p->pos++;
+	}
+	*first = false;
+
+	return 1;
+}
+
+/**
+ * Skip a JSON value
+ * @param p the parser
+ *
+ * Parse and discard the next JSON value.  Returns zero on success, negative
+ * values on failure.
+ *
+ */
+static int _oci_skip(struct oci_parser *p)
+{
+	int rc;
+	bool first = true;
+	bool neg;
+	uint64_t val;
+
+	switch (_oci_ws(p)) {
+	case '"':
+		return _oci_string(p, NULL, 0);
+	case '{':
+		rc = _oci_open(p, '{');
+		while (rc > 0 && (rc = _oci_obj_next(p, &first, NULL, 0)) > 0) {
+			rc = _oci_skip(p);
+			rc = (rc < 0 ? rc : 1);
+		}
+		return rc;
+	case '[':
+		rc = _oci_open(p, '[');
+		while (rc > 0 && (rc = _oci_arr_next(p, &first)) > 0) {
+			rc = _oci_skip(p);
+			rc = (rc < 0 ? rc : 1);
+		}
+		return rc;
+	case 't':
+		return _oci_literal(p, "true");
+	case 'f':
+		return _oci_literal(p, "false");
+	case 'n':
+		return _oci_literal(p, "null");
+	default:
+		/* integers are the only remaining valid profile values */
+		return _oci_number(p, &val, &neg);
+	}
+}
+
+/**
+ * Parse an action
+ * @param p the parser
+ * @param action the action
+ *
+ * Parse an action name, e.g. "SCMP_ACT_ERRNO".  The ERRNO and TRACE actions
+ * are returned without their return value.  Returns zero on success, negative
+ * values on failure.
+ *
+ */
+static int _oci_action(struct oci_parser *p, uint32_t *action)
+{
+	int rc;
+	char str[OCI_STR_MAX];
+
+	rc = _oci_string(p, str, sizeof(str));
+	if (rc < 0)
+		return rc;
+	return _oci_lookup(_oci_actions, str, action);
+}
+
+/**
+ * Apply the return value to an action
+ * @param action the action
+ * @param errno_set true if a return value was given
+ * @param errno_ret the return value
+ *
+ * Profiles carry the return value of the ERRNO and TRACE actions separately,
+ * defaulting to EPERM.  Returns the complete action.
+ *
+ */
+static uint32_t _oci_action_ret(uint32_t action,
+				bool errno_set, uint32_t errno_ret)
+{
+	if (action != SCMP_ACT_ERRNO(0) && action != SCMP_ACT_TRACE(0))
+		return action;
+	return action | ((errno_set ? errno_ret : EPERM) & 0x0000ffff);
+}
+
+/**
+ * Parse an array of architectures
+ * @param p the parser
+ * @param arches the architecture token list
+ * @param arch_cnt the number of entries in the list
+ *
+ * Parse an array of architecture names, adding each architecture to the list
+ * if it isn't already present.  Returns zero on success, negative values on
+ * failure.
+ *
+ */
+static int _oci_arches(struct oci_parser *p,
+		       uint32_t *arches, unsigned int *arch_cnt)
+{
+	int rc;
+	bool first = true;
+	unsigned int iter;
+	char str[OCI_STR_MAX];
+	const struct arch_def *arch;
+
+	rc = _oci_open(p, '[');
+	while (rc > 0 && (rc = _oci_arr_next(p, &first)) > 0) {
+		rc = _oci_string(p, str, sizeof(str));
+		if (rc < 0)
+			return rc;
+		arch = _oci_arch_lookup(str);
+		if (arch == NULL)
+			return -EINVAL;
+
+		for (iter = 0; iter < *arch_cnt; iter++) {
+			if (arches[iter] == arch->token)
+				break;
+		}
+		if (iter == *arch_cnt) {
+			if (*arch_cnt >= OCI_ARCH_MAX)
+				return -EINVAL;
+			arches[(*arch_cnt)++] = arch->token;
+		}
+		rc = 1;
+	}
+
+	return rc;
+}
+
+/**
+ * Parse the architecture map
+ * @param p the parser
+ * @param prof the profile
+ *
+ * Parse the Docker "archMap" array, recording the native architecture and its
+ * sub-architectures.  Returns zero on success, negative values on failure.
+ *
+ */
+static int _oci_arch_map(struct oci_parser *p, struct oci_profile *prof)
+{
+	int rc;
+	bool first = true, m_first;
+	char key[OCI_STR_MAX];
+	char str[OCI_STR_MAX];
+	const struct arch_def *arch;
+	uint32_t subs[OCI_ARCH_MAX];
+	unsigned int sub_cnt, iter;
+	uint32_t token;
+
+	rc = _oci_open(p, '[');
+	while (rc > 0 && (rc = _oci_arr_next(p, &first)) > 0) {
+		token = 0;
+		sub_cnt = 0;
+		m_first = true;
+		rc = _oci_open(p, '{');
+		while (rc > 0 &&
+		       (rc = _oci_obj_next(p, &m_first, key, sizeof(key))) > 0) {
+			if (strcmp(key, "architecture") == 0) {
+				rc = _oci_string(p, str, sizeof(str));
+				if (rc < 0)
+					return rc;
+				arch = _oci_arch_lookup(str);
+				if (arch == NULL)
+					return -EINVAL;
+				token = arch->token;
+			} else if (strcmp(key, "subArchitectures") == 0)
+				rc = _oci_arches(p, subs, &sub_cnt);
+			else
+				rc = _oci_skip(p);
+			rc = (rc < 0 ? rc : 1);
+		}
+		if (rc < 0)
+			return rc;
+
+		if (token != arch_def_native->token) {
+			rc = 1;
+			continue;
+		}
+		if (prof->arch_map_cnt + 1 + sub_cnt > OCI_ARCH_MAX)
+			return -EINVAL;
+		prof->arch_map[prof->arch_map_cnt++] = token;
+		for (iter = 0; iter < sub_cnt; iter++)
+			prof->arch_map[prof->arch_map_cnt++] = subs[iter];
+		rc = 1;
+	}
+
+	return rc;
+}
+
+/**
+ * Parse a kernel version
+ * @param str the version string, e.g. "4.8" or "6.1.0-13-amd64"
+ * @param ver the major and minor version numbers
+ *
+ * Parse the major and minor version numbers from the start of a kernel
+ * version string, anything after the minor version is ignored.  Returns zero
+ * on success, negative values on failure.
+ *
+ */
+static int _oci_version(const char *str, unsigned int *ver)
+{
+	unsigned int iter;
+
+	for (iter = 0; iter < 2; iter++) {
+		if (*str < '0' || *str > '9')
+			return -EINVAL;
+		ver[iter] = 0;
+		while (*str >= '0' && *str <= '9') {
+			if (ver[iter] > 0xffff)
+				return -EINVAL;
+			ver[iter] = ver[iter] * 10 + (*str++ - '0');
+		}
+		if (iter == 0 && *str++ != '.')
+			return -EINVAL;
+	}
+
+	return 0;
+}
+
+/**
+ * Test if a capability is held
+ * @param prof the profile
+ * @param name the capability name, e.g. "CAP_SYS_ADMIN"
+ *
+ * Returns true if the named capability is in the set given by the caller,
+ * unknown capabilities are never held.
+ *
+ */
+static bool _oci_cap_held(const struct oci_profile *prof, const char *name)
+{
+	unsigned int iter;
+
+	for (iter = 0; iter < sizeof(_oci_caps) / sizeof(_oci_caps[0]); iter++) {
+		if (strcmp(_oci_caps[iter], name) == 0)
+			return ((prof->caps >> iter) & 1);
+	}
+	return false;
+}
+
+/**
+ * Parse the "includes" or "excludes" conditions of a syscall entry
+ * @param p the parser
+ * @param prof the profile
+ * @param include true for "includes", false for "excludes"
+ * @param skip set if the conditions drop the syscall entry
+ *
+ * An entry is only included if every capability in "includes" is held, the
+ * native architecture is one of the "includes" architectures, and the running
+ * kernel is at least the "includes" minimum kernel version.  An entry is
+ * excluded if any capability in "excludes" is held, the native architecture is
+ * one of the "excludes" architectures, or the running kernel is at least the
+ * "excludes" minimum kernel version.  Returns zero on success, negative values
+ * on failure.
+ *
+ */
+static int _oci_cond(struct oci_parser *p, struct oci_profile *prof,
+		     bool include, bool *skip)
+{
+	int rc;
+	bool first = true, a_first;
+	bool match;
+	unsigned int cnt;
+	unsigned int ver[2];
+	char key[OCI_STR_MAX];
+	char str[OCI_STR_MAX];
+	const struct arch_def *arch;
+
+	rc = _oci_open(p, '{');
+	while (rc > 0 && (rc = _oci_obj_next(p, &first, key, sizeof(key))) > 0) {
+		if (strcmp(key, "caps") == 0) {
+			a_first = true;
+			rc = _oci_open(p, '[');
+			while (rc > 0 && (rc = _oci_arr_next(p, &a_first)) > 0) {
+				rc = _oci_string(p, str, sizeof(str));
+				if (rc < 0)
+					return rc;
+				if (_oci_cap_held(prof, str) != include)
+					*skip = true;
+				rc = 1;
+			}
+		} else if (strcmp(key, "arches") == 0) {
+			a_first = true;
+			match = false;
+			cnt = 0;
+			rc = _oci_open(p, '[');
+			while (rc > 0 && (rc = _oci_arr_next(p, &a_first)) > 0) {
+				rc = _oci_string(p, str, sizeof(str));
+				if (rc < 0)
+					return rc;
+				arch = _oci_arch_lookup(str);
+				if (arch != NULL &&
+				    arch->token == arch_def_native->token)
+					match = true;
+				cnt++;
+				rc = 1;
+			}
+			if (cnt > 0 && match != include)
+				*skip = true;
+		} else if (strcmp(key, "minKernel") == 0) {
+			if (_oci_ws(p) == 'n') {
+				rc = _oci_literal(p, "null");
+			} else {
+				rc = _oci_string(p, str, sizeof(str));
+				if (rc < 0)
+					return rc;
+				rc = _oci_version(str, ver);
+				if (rc < 0)
+					return rc;
+				match = (prof->kver[0] > ver[0] ||
+					 (prof->kver[0] == ver[0] &&
+					  prof->kver[1] >= ver[1]));
+				if (match != include)
+					*skip = true;
+			}
+		} else
+			rc = _oci_skip(p);
+		rc = (rc < 0 ? rc : 1);
+	}
+
+	return rc;
+}
+
+/**
+ * Parse a syscall argument comparison
+ * @param p the parser
+ * @param prof the profile
+ *
+ * Parse an argument comparison object and append it to the profile's argument
+ * list.  Returns zero on success, negative values on failure.
+ *
+ */
+static int _oci_arg(struct oci_parser *p, struct oci_profile *prof)
+{
+	int rc;
+	bool first = true;
+	bool op_set = false;
+	char key[OCI_STR_MAX];
+	char str[OCI_STR_MAX];
+	struct scmp_arg_cmp arg;
+	uint64_t val;
+	uint32_t op = 0;
+
+	memset(&arg, 0, sizeof(arg));
+	rc = _oci_open(p, '{');
+	if (rc <= 0)
+		return (rc < 0 ? rc : -EINVAL);
+	while (rc > 0 && (rc = _oci_obj_next(p, &first, key, sizeof(key))) > 0) {
+		if (strcmp(key, "index") == 0) {
+			rc = _oci_uint(p, UINT32_MAX, &val);
+			arg.arg = val;
+		} else if (strcmp(key, "value") == 0)
+			rc = _oci_uint(p, UINT64_MAX, &arg.datum_a);
+		else if (strcmp(key, "valueTwo") == 0)
+			rc = _oci_uint(p, UINT64_MAX, &arg.datum_b);
+		else if (strcmp(key, "op") == 0) {
+			rc = _oci_string(p, str, sizeof(str));
+			if (rc == 0)
+				rc = _oci_lookup(_oci_ops, str, &op);
+			arg.op = op;
+			op_set = true;
+		} else
+			rc = _oci_skip(p);
+		rc = (rc < 0 ? rc : 1);
+	}
+	if (rc < 0)
+		return rc;
+	if (!op_set)
+		return -EINVAL;
+
+	rc = _oci_grow((void **)&prof->args, &prof->arg_max,
+		       prof->arg_cnt, sizeof(*prof->args));
+	if (rc < 0)
+		return rc;
+	prof->args[prof->arg_cnt++] = arg;
+
+	return 0;
+}
+
+/**
+ * Resolve a syscall name for a syscall entry
+ * @param ent the syscall entry
+ * @param name the syscall name
+ *
+ * Resolve the syscall name on the native architecture and add it to the
+ * syscall entry; the filter translates the syscall for the other
+ * architectures.  Unknown syscalls are ignored, as runc does, so that a
+ * profile can be shared across kernel and library versions.  Returns zero on
+ * success, negative values on failure.
+ *
+ */
+static int _oci_sys_add(struct oci_entry *ent, const char *name)
+{
+	int rc;
+	int sys;
+
+	sys = arch_syscall_resolve_name(arch_def_native, name);
+	if (sys == __NR_SCMP_ERROR)
+		return 0;
+	rc = arch_syscall_rewrite(arch_def_native, &sys);
+	if (rc < 0 && rc != -EDOM)
+		return 0;
+
+	rc = _oci_grow((void **)&ent->sys, &ent->sys_max,
+		       ent->sys_cnt, sizeof(*ent->sys));
+	if (rc < 0)
+		return rc;
+	ent->sys[ent->sys_cnt++] = sys;
+
+	return 0;
+}
+
+/**
+ * Parse a syscall entry
+ * @param p the parser
+ * @param prof the profile
+ *
+ * Parse a single entry of the "syscalls" array and, unless its conditions
+ * drop it, append a rule for each of its syscalls to the profile.  Returns
+ * zero on success, negative values on failure.
+ *
+ */
+static int _oci_syscall(struct oci_parser *p, struct oci_profile *prof)
+{
+	int rc;
+	bool first = true, a_first;
+	bool split = false;
+	unsigned int iter, i_a, i_b;
+	uint32_t action;
+	uint64_t val;
+	char key[OCI_STR_MAX];
+	char str[OCI_STR_MAX];
+	struct oci_entry ent;
+	struct oci_rule *rule;
+
+	memset(&ent, 0, sizeof(ent));
+	ent.arg_off = prof->arg_cnt;
+
+	rc = _oci_open(p, '{');
+	if (rc == 0)
+		rc = -EINVAL;
+	while (rc > 0 && (rc = _oci_obj_next(p, &first, key, sizeof(key))) > 0) {
+		if (strcmp(key, "names") == 0) {
+			a_first = true;
+			rc = _oci_open(p, '[');
+			while (rc > 0 && (rc = _oci_arr_next(p, &a_first)) > 0) {
+				rc = _oci_string(p, str, sizeof(str));
+				if (rc == 0)
+					rc = _oci_sys_add(&ent, str);
+				rc = (rc < 0 ? rc : 1);
+			}
+		} else if (strcmp(key, "name") == 0) {
+			rc = _oci_string(p, str, sizeof(str));
+			if (rc == 0)
+				rc = _oci_sys_add(&ent, str);
+		} else if (strcmp(key, "action") == 0) {
+			rc = _oci_action(p, &ent.action);
+			ent.act_set = true;
+		} else if (strcmp(key, "errnoRet") == 0) {
+			rc = _oci_uint(p, 0xffff, &val);
+			ent.errno_ret = val;
+			ent.errno_set = true;
+		} else if (strcmp(key, "args") == 0) {
+			a_first = true;
+			rc = _oci_open(p, '[');
+			while (rc > 0 && (rc = _oci_arr_next(p, &a_first)) > 0) {
+				rc = _oci_arg(p, prof);
+				rc = (rc < 0 ? rc : 1);
+			}
+		} else if (strcmp(key, "includes") == 0)
+			rc = _oci_cond(p, prof, true, &ent.skip);
+		else if (strcmp(key, "excludes") == 0)
+			rc = _oci_cond(p, prof, false, &ent.skip);
+		else
+			rc = _oci_skip(p);
+		rc = (rc < 0 ? rc : 1);
+	}
+	if (rc == 0 && !ent.act_set)
+		rc = -EINVAL;
+	if (rc < 0 || ent.skip || ent.sys_cnt == 0) {
+		prof->arg_cnt = ent.arg_off;
+		goto syscall_return;
+	}
+	ent.arg_cnt = prof->arg_cnt - ent.arg_off;
+	action = _oci_action_ret(ent.action, ent.errno_set, ent.errno_ret);
+
+	/* like runc, if more than one comparison tests the same argument we
+	 * add a separate rule for each comparison */
+	for (i_a = 0; i_a < ent.arg_cnt; i_a++) {
+		for (i_b = i_a + 1; i_b < ent.arg_cnt; i_b++) {
+			if (prof->args[ent.arg_off + i_a].arg ==
+			    prof->args[ent.arg_off + i_b].arg)
+				split = true;
+		}
+	}
+
+	for (iter = 0; iter < ent.sys_cnt; iter++) {
+		for (i_a = 0; i_a < (split ? ent.arg_cnt : 1); i_a++) {
+			rc = _oci_grow((void **)&prof->rules, &prof->rule_max,
+				       prof->rule_cnt, sizeof(*prof->rules));
+			if (rc < 0)
+				goto syscall_return;
+			rule = &prof->rules[prof->rule_cnt++];
+			rule->action = action;
+			rule->syscall = ent.sys[iter];
+			rule->arg_off = ent.arg_off + (split ? i_a : 0);
+			rule->arg_cnt = (split ? 1 : ent.arg_cnt);
+		}
+	}
+
+syscall_return:
+	if (ent.sys != NULL)
+		zfree(ent.sys);
+	return rc;
+}
+
+/**
+ * Parse the filter flags
+ * @param p the parser
+ * @param flags the flags, indexed by _oci_flags[]
+ *
+ * Returns zero on success, negative values on failure.
+ *
+ */
+static int _oci_filter_flags(struct oci_parser *p, unsigned int *flags)
+{
+	int rc;
+	bool first = true;
+	unsigned int iter;
+	char str[OCI_STR_MAX];
+
+	rc = _oci_open(p, '[');
+	while (rc > 0 && (rc = _oci_arr_next(p, &first)) > 0) {
+		rc = _oci_string(p, str, sizeof(str));
+		if (rc < 0)
+			return rc;
+		for (iter = 0; _oci_flags[iter].name != NULL; iter++) {
+			if (strcmp(_oci_flags[iter].name, str) == 0)
+				break;
+		}
+		if (_oci_flags[iter].name == NULL)
+			return -EINVAL;
+		*flags |= (1 << iter);
+		rc = 1;
+	}
+
+	return rc;
+}
+
+/**
+ * Parse a profile
+ * @param p the parser
+ * @param prof the profile
+ *
+ * Parse the top level object of the profile.  Returns zero on success,
+ * negative values on failure.
+ *
+ */
+static int _oci_profile(struct oci_parser *p, struct oci_profile *prof)
+{
+	int rc;
+	bool first = true, a_first;
+	uint64_t val;
+	char key[OCI_STR_MAX];
+
+	rc = _oci_open(p, '{');
+	if (rc == 0)
+		rc = -EINVAL;
+	while (rc > 0 && (rc = _oci_obj_next(p, &first, key, sizeof(key))) > 0) {
+		if (strcmp(key, "defaultAction") == 0) {
+			rc = _oci_action(p, &prof->def_action);
+			prof->def_set = true;
+		} else if (strcmp(key, "defaultErrnoRet") == 0) {
+			rc = _oci_uint(p, 0xffff, &val);
+			prof->def_errno = val;
+			prof->def_errno_set = true;
+		} else if (strcmp(key, "architectures") == 0)
+			rc = _oci_arches(p, prof->arches, &prof->arch_cnt);
+		else if (strcmp(key, "archMap") == 0)
+			rc = _oci_arch_map(p, prof);
+		else if (strcmp(key, "flags") == 0)
+			rc = _oci_filter_flags(p, &prof->flags);
+		else if (strcmp(key, "syscalls") == 0) {
+			a_first = true;
+			rc = _oci_open(p, '[');
+			while (rc > 0 && (rc = _oci_arr_next(p, &a_first)) > 0) {
+				rc = _oci_syscall(p, prof);
+				rc = (rc < 0 ? rc : 1);
+			}
+		} else
+			rc = _oci_skip(p);
+		rc = (rc < 0 ? rc : 1);
+	}
+	if (rc < 0)
+		return rc;
+
+	/* nothing may follow the profile and the default action is required */
+	if (_oci_ws(p) != -1 || !prof->def_set)
+		return -EINVAL;
+
+	return 0;
+}
+
+/**
+ * Load an OCI seccomp profile into a filter collection
+ * @param col the filter collection
+ * @param buf the JSON encoded profile
+ * @param len the length of the profile
+ * @param caps bitmask of the capabilities held
+ *
+ * This function parses the profile in full before it touches the filter
+ * collection, then sets the default action, adds any missing architectures,
+ * applies the filter flags and adds all of the rules with a single batch.  On
+ * failure the filter collection is left unchanged.  Returns zero on success,
+ * negative values on failure.
+ *
+ */
+int oci_import(struct db_filter_col *col,
+	       const char *buf, size_t len, uint64_t caps)
+{
+	int rc;
+	unsigned int iter, r_cnt = 0;
+	unsigned int arch_cnt, added_cnt = 0;
+	const uint32_t *arches;
+	uint32_t added[OCI_ARCH_MAX];
+	uint32_t def_action;
+	struct db_filter_attr attr_old;
+	struct oci_parser p;
+	struct oci_profile prof;
+	struct oci_rule *o_rule;
+	struct scmp_rule *rules = NULL;
+	struct utsname uts;
+
+	/* profiles can only be loaded into an empty filter */
+	for (iter = 0; iter < col->filter_cnt; iter++) {
+		if (col->filters[iter]->rules != NULL)
+			return -EEXIST;
+	}
+
+	memset(&prof, 0, sizeof(prof));
+	prof.caps = caps;
+	if (uname(&uts) < 0 || _oci_version(uts.release, prof.kver) < 0) {
+		/* treat an unknown kernel as older than any minimum */
+		prof.kver[0] = 0;
+		prof.kver[1] = 0;
+	}
+
+	p.buf = buf;
+	p.len = len;
+	p.pos = 0;
+	p.depth = 0;
+	rc = _oci_profile(&p, &prof);
+	if (rc < 0)
+		goto import_return;
+	def_action = _oci_action_ret(prof.def_action,
+				     prof.def_errno_set, prof.def_errno);
+	rc = db_col_action_valid(col, def_action);
+	if (rc < 0)
+		goto import_return;
+	if (prof.rule_cnt > 0) {
+		rules = zmalloc(sizeof(*rules) * prof.rule_cnt);
+		if (rules == NULL) {
+			rc = -ENOMEM;
+			goto import_return;
+		}
+	}
+
+	/* NOTE: everything below must be undone on failure */
+	attr_old = col->attr;
+
+	/* the "architectures" list takes precedence over the "archMap" */
+	arches = (prof.arch_cnt > 0 ? prof.arches : prof.arch_map);
+	arch_cnt = (prof.arch_cnt > 0 ? prof.arch_cnt : prof.arch_map_cnt);
+	for (iter = 0; iter < arch_cnt; iter++) {
+		if (db_col_arch_exist(col, arches[iter]))
+			continue;
+		rc = db_col_db_new(col, arch_def_lookup(arches[iter]));
+		if (rc < 0)
+			goto import_undo;
+		added[added_cnt++] = arches[iter];
+	}
+
+	for (iter = 0; _oci_flags[iter].name != NULL; iter++) {
+		if ((prof.flags & (1 << iter)) == 0)
+			continue;
+		rc = db_col_attr_set(col, _oci_flags[iter].val, 1);
+		if (rc < 0)
+			goto import_undo;
+	}
+	col->attr.act_default = def_action;
+
+	/* rules matching the default action are redundant, runc skips them */
+	for (iter = 0; iter < prof.rule_cnt; iter++) {
+		o_rule = &prof.rules[iter];
+		if (o_rule->action == def_action)
+			continue;
+		rc = db_col_action_valid(col, o_rule->action);
+		if (rc < 0)
+			goto import_undo;
+		rules[r_cnt].action = o_rule->action;
+		rules[r_cnt].syscall = o_rule->syscall;
+		rules[r_cnt].arg_cnt = o_rule->arg_cnt;
+		rules[r_cnt].arg_array = (o_rule->arg_cnt > 0 ?
+					  &prof.args[o_rule->arg_off] : NULL);
+		r_cnt++;
+	}
+	rc = db_col_rule_add_batch(col, rules, r_cnt);
+	if (rc < 0)
+		goto import_undo;
+
+	db_col_precompute_reset(col);
+	goto import_return;
+
+import_undo:
+	col->attr = attr_old;
+	for (iter = 0; iter < added_cnt; iter++)
+		db_col_db_remove(col, added[iter]);
+	db_col_precompute_reset(col);
+import_return:
+	if (rules != NULL)
+		zfree(rules);
+	if (prof.rules != NULL)
+		zfree(prof.rules);
+	if (prof.args != NULL)
+		zfree(prof.args);
+	return rc;
+}
+
+/**
+ * Load an OCI seccomp profile into a filter collection from a file
+ * @param col the filter collection
+ * @param fd the fd to read the profile from
+ * @param caps bitmask of the capabilities held
+ *
+ * This function reads the profile from the given fd until end-of-file and
+ * loads it with oci_import().  Returns zero on success, negative values on
+ * failure.
+ *
+ */
+int oci_import_fd(struct db_filter_col *col, int fd, uint64_t caps)
+{
+	int rc;
+	ssize_t r_len;
+	size_t len = 0, size = OCI_READ_SIZE;
+	char *buf, *tmp;
+
+	buf = zmalloc(size);
+	if (buf == NULL)
+		return -ENOMEM;
+	for (;;) {
+		if (len == size) {
+			tmp = zrealloc(buf, size, size * 2);
+			if (tmp == NULL) {
+				rc = -ENOMEM;
+				goto fd_return;
+			}
+			buf = tmp;
+			size *= 2;
+		}
+		r_len = read(fd, buf + len, size - len);
+		if (r_len < 0 && errno == EINTR)
+			continue;
+		if (r_len < 0) {
+			rc = -ECANCELED;
+			goto fd_return;
+		}
+		if (r_len == 0)
+			break;
+		len += r_len;
+	}
+
+	rc = oci_import(col, buf, len, caps);
+
+fd_return:
+	zfree(buf);
+	return rc;
+}
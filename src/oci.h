@@ -0,0 +1,34 @@
+/**
+ * Seccomp OCI Profile Loader
+ *
+ * Copyright (c) 2026 Microsoft Corporation <paulmoore@microsoft.com>
+ * Author: Paul Moore <paul@paul-moore.com>
+ */
+
+/*
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of version 2.1 of the GNU Lesser General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses>.
+ */
+
+#ifndef _OCI_H
+#define _OCI_H
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include "db.h"
+
+int oci_import(struct db_filter_col *col,
+	       const char *buf, size_t len, uint64_t caps);
+int oci_import_fd(struct db_filter_col *col, int fd, uint64_t caps);
+
+#endif
@@ -66,6 +66,14 @@ cdef extern from "seccomp.h":
         SCMP_FLTATR_CTL_OPTIMIZE
         SCMP_FLTATR_API_SYSRAWRC
         SCMP_FLTATR_CTL_WAITKILL
+        SCMP_FLTATR_CTL_MINIMIZE
+        SCMP_FLTATR_STAT_MIN_NODES
+        SCMP_FLTATR_STAT_MIN_INSNS
+        SCMP_FLTATR_STAT_MEM_USED
+        SCMP_FLTATR_CTL_MEM_MAX
+        SCMP_FLTATR_CTL_CACHE
+        SCMP_FLTATR_STAT_COST_BEFORE
+        SCMP_FLTATR_STAT_COST_AFTER
 
     cdef enum scmp_compare:
         SCMP_CMP_NE
@@ -94,6 +102,12 @@ cdef extern from "seccomp.h":
         scmp_datum_t datum_a
         scmp_datum_t datum_b
 
+    cdef struct scmp_rule:
+        uint32_t action
+        int syscall
+        unsigned int arg_cnt
+        const scmp_arg_cmp *arg_array
+
     cdef struct seccomp_data:
         int nr
         uint32_t arch
@@ -147,6 +161,8 @@ cdef extern from "seccomp.h":
     int seccomp_syscall_resolve_name(char *name)
     int seccomp_syscall_priority(scmp_filter_ctx ctx,
                                  int syscall, uint8_t priority)
+    int seccomp_syscall_weight(scmp_filter_ctx ctx,
+                               int syscall, uint32_t weight)
 
     int seccomp_rule_add(scmp_filter_ctx ctx, uint32_t action,
                          int syscall, unsigned int arg_cnt, ...)
@@ -160,20 +176,28 @@ cdef extern from "seccomp.h":
                                      uint32_t action, int syscall,
                                      unsigned int arg_cnt,
                                      scmp_arg_cmp *arg_array)
+    int seccomp_rule_add_batch(scmp_filter_ctx ctx,
+                               scmp_rule *rules, unsigned int rule_cnt) nogil
 
     int seccomp_notify_alloc(seccomp_notif **req, seccomp_notif_resp **resp)
     void seccomp_notify_free(seccomp_notif *req, seccomp_notif_resp *resp)
-    int seccomp_notify_receive(int fd, seccomp_notif *req)
-    int seccomp_notify_respond(int fd, seccomp_notif_resp *resp)
-    int seccomp_notify_id_valid(int fd, uint64_t id)
+    int seccomp_notify_receive(int fd, seccomp_notif *req) nogil
+    int seccomp_notify_respond(int fd, seccomp_notif_resp *resp) nogil
+    int seccomp_notify_id_valid(int fd, uint64_t id) nogil
     int seccomp_notify_fd(scmp_filter_ctx ctx)
 
     int seccomp_export_pfc(scmp_filter_ctx ctx, int fd)
     int seccomp_export_bpf(scmp_filter_ctx ctx, int fd)
     int seccomp_export_bpf_mem(const scmp_filter_ctx ctx, void *buf,
-                               size_t *len)
+                               size_t *len) nogil
+    int seccomp_export_db(const scmp_filter_ctx ctx, void *buf, size_t *len)
+    int seccomp_import_db(scmp_filter_ctx ctx, const void *buf, size_t len)
 
     int seccomp_precompute(const scmp_filter_ctx ctx)
 
+    int seccomp_import_oci(scmp_filter_ctx ctx, const char *buf, size_t len,
+                           uint64_t caps)
+    int seccomp_import_oci_fd(scmp_filter_ctx ctx, int fd, uint64_t caps)
+
 # kate: syntax python;
 # kate: indent-mode python; space-indent on; indent-width 4; mixedindent off;
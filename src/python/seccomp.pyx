@@ -84,12 +84,22 @@ from cpython cimport array
 from cpython.version cimport PY_MAJOR_VERSION
 from libc.stdint cimport int8_t, int16_t, int32_t, int64_t
 from libc.stdint cimport uint8_t, uint16_t, uint32_t, uint64_t
-from libc.stdlib cimport free
+from libc.stdlib cimport free, malloc
+from libc.string cimport memcpy, memset
 import array
 import errno
 
 cimport libseccomp
 
+cdef extern from "poll.h" nogil:
+    cdef struct pollfd:
+        int fd
+        short events
+        short revents
+    int poll(pollfd *fds, unsigned long nfds, int timeout)
+    enum:
+        POLLIN
+
 def c_str(string):
     """ Convert a Python string to a C string.
 
@@ -332,8 +342,17 @@ cdef class Attr:
                    0: currently unused
                    1: rules weighted by priority and complexity (DEFAULT)
                    2: binary tree sorted by syscall number
+                   3: rules weighted by expected cost
     API_SYSRAWRC - return the raw syscall codes
     CTL_WAITKILL - request wait killable semantics
+    CTL_MINIMIZE - minimize the generated filter
+    STAT_MIN_NODES - the number of tests removed by CTL_MINIMIZE
+    STAT_MIN_INSNS - the number of instructions removed by CTL_MINIMIZE
+    STAT_MEM_USED - the number of bytes allocated by the filter
+    CTL_MEM_MAX - the maximum number of bytes the filter may allocate
+    CTL_CACHE - share the generated filter with identical filters
+    STAT_COST_BEFORE - the expected syscall cost with the default ordering
+    STAT_COST_AFTER - the expected syscall cost with the weighted ordering
     """
     ACT_DEFAULT = libseccomp.SCMP_FLTATR_ACT_DEFAULT
     ACT_BADARCH = libseccomp.SCMP_FLTATR_ACT_BADARCH
@@ -345,6 +364,14 @@ cdef class Attr:
     CTL_OPTIMIZE = libseccomp.SCMP_FLTATR_CTL_OPTIMIZE
     API_SYSRAWRC = libseccomp.SCMP_FLTATR_API_SYSRAWRC
     CTL_WAITKILL = libseccomp.SCMP_FLTATR_CTL_WAITKILL
+    CTL_MINIMIZE = libseccomp.SCMP_FLTATR_CTL_MINIMIZE
+    STAT_MIN_NODES = libseccomp.SCMP_FLTATR_STAT_MIN_NODES
+    STAT_MIN_INSNS = libseccomp.SCMP_FLTATR_STAT_MIN_INSNS
+    STAT_MEM_USED = libseccomp.SCMP_FLTATR_STAT_MEM_USED
+    CTL_MEM_MAX = libseccomp.SCMP_FLTATR_CTL_MEM_MAX
+    CTL_CACHE = libseccomp.SCMP_FLTATR_CTL_CACHE
+    STAT_COST_BEFORE = libseccomp.SCMP_FLTATR_STAT_COST_BEFORE
+    STAT_COST_AFTER = libseccomp.SCMP_FLTATR_STAT_COST_AFTER
 
 cdef class Arg:
     """ Python object representing a SyscallFilter syscall argument.
@@ -482,6 +509,22 @@ cdef class Notification:
                 self._syscall_args[2], self._syscall_args[3],
                 self._syscall_args[4], self._syscall_args[5]]
 
+cdef Notification _notification(libseccomp.seccomp_notif *req):
+    """ Create a Notification object from a C structure.
+
+    Arguments:
+    req - the notification request
+
+    Description:
+    Helper function which should only be used internally by SyscallFilter
+    objects.
+    """
+    return Notification(req.id, req.pid, req.flags, req.data.nr,
+                        req.data.arch, req.data.instruction_pointer,
+                        (req.data.args[0], req.data.args[1],
+                         req.data.args[2], req.data.args[3],
+                         req.data.args[4], req.data.args[5]))
+
 cdef class NotificationResponse:
     """ Python object representing a seccomp notification response.
     """
@@ -595,6 +638,9 @@ cdef class SyscallFilter:
     """ Python object representing a seccomp syscall filter. """
     cdef int _defaction
     cdef libseccomp.scmp_filter_ctx _ctx
+    cdef libseccomp.seccomp_notif *_notify_req
+    cdef libseccomp.seccomp_notif_resp *_notify_resp
+    cdef bint _notify_busy
 
     def __cinit__(self, int defaction):
         self._ctx = libseccomp.seccomp_init(defaction)
@@ -622,6 +668,52 @@ cdef class SyscallFilter:
         """
         if self._ctx != NULL:
             libseccomp.seccomp_release(self._ctx)
+        if self._notify_req != NULL:
+            libseccomp.seccomp_notify_free(self._notify_req,
+                                           self._notify_resp)
+
+    cdef int _notify_bufs_get(self, libseccomp.seccomp_notif **req,
+                              libseccomp.seccomp_notif_resp **resp):
+        """ Get a pair of notification buffers.
+
+        Arguments:
+        req - the request buffer
+        resp - the response buffer
+
+        Description:
+        Helper which returns the filter's notification buffers, allocating
+        them on first use, so that they can be reused for each
+        notification.  If the buffers are already in use by another thread
+        a new pair is allocated instead.  The buffers must be returned with
+        _notify_bufs_put().
+        """
+        if self._notify_busy:
+            return libseccomp.seccomp_notify_alloc(req, resp)
+        if self._notify_req == NULL:
+            rc = libseccomp.seccomp_notify_alloc(&self._notify_req,
+                                                 &self._notify_resp)
+            if rc < 0:
+                return rc
+        self._notify_busy = True
+        req[0] = self._notify_req
+        resp[0] = self._notify_resp
+        return 0
+
+    cdef void _notify_bufs_put(self, libseccomp.seccomp_notif *req,
+                               libseccomp.seccomp_notif_resp *resp):
+        """ Return a pair of notification buffers.
+
+        Arguments:
+        req - the request buffer
+        resp - the response buffer
+
+        Description:
+        Helper which returns a pair of buffers from _notify_bufs_get().
+        """
+        if req == self._notify_req:
+            self._notify_busy = False
+        else:
+            libseccomp.seccomp_notify_free(req, resp)
 
     def reset(self, int defaction = -1):
         """ Reset the filter state.
@@ -792,6 +884,33 @@ cdef class SyscallFilter:
         if rc != 0:
             raise RuntimeError(str.format("Library error (errno = {0})", rc))
 
+    def syscall_weight(self, syscall, weight):
+        """ Set the filter weight of a syscall.
+
+        Arguments:
+        syscall - the syscall name or number
+        weight - the relative hit frequency of the syscall
+
+        Description:
+        Set the expected relative hit frequency of the given syscall.  When
+        the filter's CTL_OPTIMIZE attribute is set to 3 the syscalls are
+        ordered to minimize the expected overhead in the generated filter
+        code.  Weight values can range from 0 to 4294967295 inclusive.
+        """
+        if weight < 0 or weight > 0xffffffff:
+            raise ValueError("Syscall weight must be between 0 and 4294967295")
+        if isinstance(syscall, str):
+            syscall_str = syscall.encode()
+            syscall_num = libseccomp.seccomp_syscall_resolve_name(syscall_str)
+        elif isinstance(syscall, int):
+            syscall_num = syscall
+        else:
+            raise TypeError("Syscall must either be an int or str type")
+        rc = libseccomp.seccomp_syscall_weight(self._ctx,
+                                               syscall_num, weight)
+        if rc != 0:
+            raise RuntimeError(str.format("Library error (errno = {0})", rc))
+
     def add_rule(self, int action, syscall, *args):
         """ Add a new rule to filter.
 
@@ -959,34 +1078,178 @@ cdef class SyscallFilter:
         if rc != 0:
             raise RuntimeError(str.format("Library error (errno = {0})", rc))
 
+    def add_rules(self, rules):
+        """ Add a sequence of new rules to the filter.
+
+        Arguments:
+        rules - a sequence of (action, syscall, args...) tuples, where each
+                argument comparison is either an Arg object or an
+                (arg, op, datum_a[, datum_b]) tuple
+
+        Description:
+        Add each of the given rules to the filter as if add_rule() had
+        been called for each rule in turn.  The rules are converted and
+        passed to the library in a single call, made without holding the
+        GIL, which is considerably faster than adding each rule
+        separately.  Either all of the rules are added or, on failure,
+        none of them are.
+        """
+        cdef libseccomp.scmp_rule *c_rules = NULL
+        cdef libseccomp.scmp_arg_cmp *c_args = NULL
+        cdef libseccomp.scmp_filter_ctx ctx = self._ctx
+        cdef unsigned int rule_cnt
+        cdef unsigned int arg_cnt = 0
+        cdef int action
+        cdef int rc
+        cdef Arg arg
+        rules = list(rules)
+        rule_cnt = len(rules)
+        if rule_cnt == 0:
+            return
+        c_rules = <libseccomp.scmp_rule *>malloc(
+                            rule_cnt * sizeof(libseccomp.scmp_rule))
+        c_args = <libseccomp.scmp_arg_cmp *>malloc(
+                            rule_cnt * 6 * sizeof(libseccomp.scmp_arg_cmp))
+        if c_rules == NULL or c_args == NULL:
+            free(c_rules)
+            free(c_args)
+            raise MemoryError()
+        try:
+            for i, rule in enumerate(rules):
+                if len(rule) < 2:
+                    raise TypeError("Rules must be (action, syscall, ...)")
+                if len(rule) > 8:
+                    raise RuntimeError("Maximum number of arguments exceeded")
+                action = rule[0]
+                syscall = rule[1]
+                if isinstance(syscall, str):
+                    syscall_str = syscall.encode()
+                    syscall_num = \
+                        libseccomp.seccomp_syscall_resolve_name(syscall_str)
+                elif isinstance(syscall, int):
+                    syscall_num = syscall
+                else:
+                    raise TypeError("Syscall must either be an int or str type")
+                c_rules[i].action = <uint32_t>action
+                c_rules[i].syscall = syscall_num
+                c_rules[i].arg_cnt = len(rule) - 2
+                c_rules[i].arg_array = &c_args[arg_cnt]
+                for cmp in rule[2:]:
+                    if isinstance(cmp, Arg):
+                        arg = cmp
+                        c_args[arg_cnt] = arg.to_c()
+                    else:
+                        c_args[arg_cnt].arg = cmp[0]
+                        c_args[arg_cnt].op = cmp[1]
+                        c_args[arg_cnt].datum_a = cmp[2]
+                        c_args[arg_cnt].datum_b = \
+                            cmp[3] if len(cmp) > 3 else 0
+                    arg_cnt += 1
+            with nogil:
+                rc = libseccomp.seccomp_rule_add_batch(ctx, c_rules, rule_cnt)
+        finally:
+            free(c_rules)
+            free(c_args)
+        if rc != 0:
+            raise RuntimeError(str.format("Library error (errno = {0})", rc))
+
     def receive_notify(self):
         """ Receive seccomp notifications.
 
         Description:
         Receive a seccomp notification from the system, requires the use of
-        the NOTIFY action.
+        the NOTIFY action.  The GIL is released while waiting for the
+        notification.
         """
-        cdef libseccomp.seccomp_notif *req
+        cdef libseccomp.seccomp_notif *req = NULL
+        cdef libseccomp.seccomp_notif_resp *resp = NULL
+        cdef int fd
+        cdef int rc
 
         fd = libseccomp.seccomp_notify_fd(self._ctx)
         if fd < 0:
             raise RuntimeError("Notifications not enabled/active")
-        rc = libseccomp.seccomp_notify_alloc(&req, NULL)
-        if rc < 0:
-            raise RuntimeError(str.format("Library error (errno = {0})", rc))
-        rc = libseccomp.seccomp_notify_receive(fd, req)
+        rc = self._notify_bufs_get(&req, &resp)
         if rc < 0:
             raise RuntimeError(str.format("Library error (errno = {0})", rc))
-        rc = libseccomp.seccomp_notify_id_valid(fd, req.id)
+        try:
+            with nogil:
+                # the kernel requires a zeroed request buffer
+                memset(req, 0, sizeof(libseccomp.seccomp_notif))
+                rc = libseccomp.seccomp_notify_receive(fd, req)
+                if rc == 0:
+                    rc = libseccomp.seccomp_notify_id_valid(fd, req.id)
+            if rc < 0:
+                raise RuntimeError(str.format("Library error (errno = {0})",
+                                              rc))
+            return _notification(req)
+        finally:
+            self._notify_bufs_put(req, resp)
+
+    def receive_notify_batch(self, unsigned int max_cnt = 64, block = True):
+        """ Receive a batch of seccomp notifications.
+
+        Arguments:
+        max_cnt - the maximum number of notifications to receive
+        block - wait for a notification if none are pending
+
+        Description:
+        Receive the pending seccomp notifications from the system, up to
+        max_cnt of them, and return them as a list.  The GIL is released
+        while the notifications are received.  If block is True this waits
+        until at least one notification is received, otherwise an empty
+        list is returned if none are pending; together with get_notify_fd()
+        this allows the notifications to be handled from an event loop,
+        e.g. with asyncio's loop.add_reader().  Unlike receive_notify()
+        the notification IDs are not checked, a response to a process
+        which has since gone away simply fails.
+        """
+        cdef libseccomp.seccomp_notif *req = NULL
+        cdef libseccomp.seccomp_notif_resp *resp = NULL
+        cdef libseccomp.seccomp_notif *reqs
+        cdef pollfd pfd
+        cdef bint wait = block
+        cdef unsigned int cnt = 0
+        cdef int fd
+        cdef int rc = 0
+
+        fd = libseccomp.seccomp_notify_fd(self._ctx)
+        if fd < 0:
+            raise RuntimeError("Notifications not enabled/active")
+        if max_cnt == 0:
+            return []
+        reqs = <libseccomp.seccomp_notif *>malloc(
+                            max_cnt * sizeof(libseccomp.seccomp_notif))
+        if reqs == NULL:
+            raise MemoryError()
+        rc = self._notify_bufs_get(&req, &resp)
         if rc < 0:
+            free(reqs)
             raise RuntimeError(str.format("Library error (errno = {0})", rc))
-        notify = Notification(req.id, req.pid, req.flags, req.data.nr,
-                              req.data.arch, req.data.instruction_pointer,
-                              [req.data.args[0], req.data.args[1],
-                               req.data.args[2], req.data.args[3],
-                               req.data.args[4], req.data.args[5]])
-        free(req)
-        return notify
+        try:
+            with nogil:
+                pfd.fd = fd
+                pfd.events = POLLIN
+                while cnt < max_cnt:
+                    # only the first receive may wait
+                    if cnt > 0 or not wait:
+                        pfd.revents = 0
+                        if poll(&pfd, 1, 0) <= 0 or \
+                           not (pfd.revents & POLLIN):
+                            break
+                    memset(req, 0, sizeof(libseccomp.seccomp_notif))
+                    rc = libseccomp.seccomp_notify_receive(fd, req)
+                    if rc < 0:
+                        break
+                    memcpy(&reqs[cnt], req, sizeof(libseccomp.seccomp_notif))
+                    cnt += 1
+            if rc < 0 and cnt == 0:
+                raise RuntimeError(str.format("Library error (errno = {0})",
+                                              rc))
+            return [_notification(&reqs[i]) for i in range(cnt)]
+        finally:
+            self._notify_bufs_put(req, resp)
+            free(reqs)
 
     def respond_notify(self, response):
         """ Send a seccomp notification response.
@@ -997,21 +1260,88 @@ cdef class SyscallFilter:
         Description:
         Respond to a seccomp notification.
         """
-        cdef libseccomp.seccomp_notif_resp *resp
+        cdef libseccomp.seccomp_notif *req = NULL
+        cdef libseccomp.seccomp_notif_resp *resp = NULL
+        cdef int fd
+        cdef int rc
 
         fd = libseccomp.seccomp_notify_fd(self._ctx)
         if fd < 0:
             raise RuntimeError("Notifications not enabled/active")
-        rc = libseccomp.seccomp_notify_alloc(NULL, &resp)
+        rc = self._notify_bufs_get(&req, &resp)
         if rc < 0:
             raise RuntimeError(str.format("Library error (errno = {0})", rc))
-        resp.id = response.id
-        resp.val = response.val
-        resp.error = response.error
-        resp.flags = response.flags
-        rc = libseccomp.seccomp_notify_respond(fd, resp)
+        try:
+            resp.id = response.id
+            resp.val = response.val
+            resp.error = response.error
+            resp.flags = response.flags
+            with nogil:
+                rc = libseccomp.seccomp_notify_respond(fd, resp)
+            if rc < 0:
+                raise RuntimeError(str.format("Library error (errno = {0})",
+                                              rc))
+        finally:
+            self._notify_bufs_put(req, resp)
+
+    def respond_notify_batch(self, responses):
+        """ Send a batch of seccomp notification responses.
+
+        Arguments:
+        responses - a sequence of responses to send to the system
+
+        Description:
+        Respond to a number of seccomp notifications, e.g. those returned
+        by receive_notify_batch().  The GIL is released while the
+        responses are sent.  Every response is sent even if some of them
+        fail, e.g. because the process has since gone away, after which an
+        error is raised if any of the responses failed.
+        """
+        cdef libseccomp.seccomp_notif *req = NULL
+        cdef libseccomp.seccomp_notif_resp *resp = NULL
+        cdef libseccomp.seccomp_notif_resp *resps
+        cdef unsigned int cnt
+        cdef unsigned int iter
+        cdef int fd
+        cdef int rc
+        cdef int rc_first = 0
+
+        fd = libseccomp.seccomp_notify_fd(self._ctx)
+        if fd < 0:
+            raise RuntimeError("Notifications not enabled/active")
+        responses = list(responses)
+        cnt = len(responses)
+        if cnt == 0:
+            return
+        resps = <libseccomp.seccomp_notif_resp *>malloc(
+                            cnt * sizeof(libseccomp.seccomp_notif_resp))
+        if resps == NULL:
+            raise MemoryError()
+        rc = self._notify_bufs_get(&req, &resp)
         if rc < 0:
+            free(resps)
             raise RuntimeError(str.format("Library error (errno = {0})", rc))
+        try:
+            for i, response in enumerate(responses):
+                resps[i].id = response.id
+                resps[i].val = response.val
+                resps[i].error = response.error
+                resps[i].flags = response.flags
+            with nogil:
+                # the kernel's response may be larger than ours, so send
+                # each one from the full sized buffer
+                for iter in range(cnt):
+                    memcpy(resp, &resps[iter],
+                           sizeof(libseccomp.seccomp_notif_resp))
+                    rc = libseccomp.seccomp_notify_respond(fd, resp)
+                    if rc < 0 and rc_first == 0:
+                        rc_first = rc
+            if rc_first < 0:
+                raise RuntimeError(str.format("Library error (errno = {0})",
+                                              rc_first))
+        finally:
+            self._notify_bufs_put(req, resp)
+            free(resps)
 
     def get_notify_fd(self):
         """ Get the seccomp notification file descriptor
@@ -1063,22 +1393,99 @@ cdef class SyscallFilter:
         Return the filter in Berkeley Packet Filter (BPF) as bytes.
         The output is identical to what is loaded into the Linux Kernel.
         """
+        cdef libseccomp.scmp_filter_ctx ctx = self._ctx
         cdef size_t len = 0
+        cdef int rc
 
-        # Figure out how big the program is.
-        rc = libseccomp.seccomp_export_bpf_mem(self._ctx, NULL, <size_t *>&len)
+        # Figure out how big the program is, generating it if needed.
+        with nogil:
+            rc = libseccomp.seccomp_export_bpf_mem(ctx, NULL, &len)
         if rc != 0:
             raise RuntimeError(str.format("Library error (errno = {0})", rc))
 
-        # Get the program.
-        cdef array.array data = array.array('B', bytes(len))
+        # Copy the program straight into an uninitialized array.
+        cdef array.array data = array.clone(array.array('B'), len, zero=False)
         cdef unsigned char[:] program = data
-        rc = libseccomp.seccomp_export_bpf_mem(self._ctx, <void *>&program[0],
-                                               <size_t *>&len)
+        rc = libseccomp.seccomp_export_bpf_mem(ctx, <void *>&program[0], &len)
         if rc != 0:
             raise RuntimeError(str.format("Library error (errno = {0})", rc))
         return program
 
+    def export_db(self):
+        """ Export the filter rule database.
+
+        Description:
+        Return a binary image of the filter's attributes, architectures
+        and rules as bytes.  The image can be loaded into a filter with
+        import_db() by the same version of libseccomp on a system with
+        the same byte order.
+        """
+        cdef size_t len = 0
+
+        # Figure out how big the image is.
+        rc = libseccomp.seccomp_export_db(self._ctx, NULL, <size_t *>&len)
+        if rc != 0:
+            raise RuntimeError(str.format("Library error (errno = {0})", rc))
+
+        # Get the image.
+        cdef array.array data = array.array('B', bytes(len))
+        cdef unsigned char[:] image = data
+        rc = libseccomp.seccomp_export_db(self._ctx, <void *>&image[0],
+                                          <size_t *>&len)
+        if rc != 0:
+            raise RuntimeError(str.format("Library error (errno = {0})", rc))
+        return bytes(image)
+
+    def import_db(self, image):
+        """ Load a filter rule database image into the filter.
+
+        Arguments:
+        image - the bytes returned by export_db()
+
+        Description:
+        Replace the filter's attributes, architectures and rules with
+        those stored in the image.  The filter is left unchanged if the
+        image is rejected.
+        """
+        cdef const unsigned char[:] buf = image
+        if len(image) == 0:
+            raise ValueError("Invalid image")
+        rc = libseccomp.seccomp_import_db(self._ctx, <const void *>&buf[0],
+                                          len(image))
+        if rc == -errno.EINVAL:
+            raise ValueError("Invalid image")
+        if rc != 0:
+            raise RuntimeError(str.format("Library error (errno = {0})", rc))
+
+    def import_oci(self, profile, caps=0):
+        """ Load an OCI seccomp profile into the filter.
+
+        Arguments:
+        profile - the JSON profile as a string, bytes or an open file
+        caps - bitmask of the capabilities held, e.g. 1 << 21 for
+               CAP_SYS_ADMIN
+
+        Description:
+        Parse an OCI runtime "linux.seccomp" JSON profile, such as the
+        Docker default profile, and load its default action,
+        architectures, flags and syscall rules into the filter.  The
+        filter must not contain any rules.
+        """
+        if hasattr(profile, "fileno"):
+            rc = libseccomp.seccomp_import_oci_fd(self._ctx,
+                                                  profile.fileno(), caps)
+        else:
+            if isinstance(profile, str):
+                profile = profile.encode()
+            rc = libseccomp.seccomp_import_oci(self._ctx, profile,
+                                               len(profile), caps)
+        if rc == -errno.EINVAL:
+            raise ValueError("Invalid profile")
+        if rc == -errno.EEXIST:
+            raise RuntimeError("Filter already contains rules")
+        if rc != 0:
+            raise RuntimeError(str.format("Library error (errno = {0})", rc))
+
     def precompute(self):
         """ Precompute the seccomp filter.
 
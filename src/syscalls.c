@@ -144,41 +144,12 @@ const char *abi_syscall_resolve_num_munge(const struct arch_def *arch, int num)
  */
 static bool _abi_syscall_socket_test(const struct arch_def *arch, int sys)
 {
-	const char *name;
-
 	/* multiplexed pseudo-syscalls */
 	if (sys <= -100 && sys >= -120)
 		return true;
 
-	name = arch->syscall_resolve_num_raw(sys);
-	if (!name)
-		return false;
-
-#define _ABI_SYSCALL_SOCK_CHK(NAME) \
-	if (!strcmp(name, #NAME)) return true;
-
-	_ABI_SYSCALL_SOCK_CHK(socket)
-	_ABI_SYSCALL_SOCK_CHK(bind)
-	_ABI_SYSCALL_SOCK_CHK(connect)
-	_ABI_SYSCALL_SOCK_CHK(listen)
-	_ABI_SYSCALL_SOCK_CHK(accept)
-	_ABI_SYSCALL_SOCK_CHK(getsockname)
-	_ABI_SYSCALL_SOCK_CHK(getpeername)
-	_ABI_SYSCALL_SOCK_CHK(socketpair)
-	_ABI_SYSCALL_SOCK_CHK(send)
-	_ABI_SYSCALL_SOCK_CHK(recv)
-	_ABI_SYSCALL_SOCK_CHK(sendto)
-	_ABI_SYSCALL_SOCK_CHK(recvfrom)
-	_ABI_SYSCALL_SOCK_CHK(shutdown)
-	_ABI_SYSCALL_SOCK_CHK(setsockopt)
-	_ABI_SYSCALL_SOCK_CHK(getsockopt)
-	_ABI_SYSCALL_SOCK_CHK(sendmsg)
-	_ABI_SYSCALL_SOCK_CHK(recvmsg)
-	_ABI_SYSCALL_SOCK_CHK(accept4)
-	_ABI_SYSCALL_SOCK_CHK(recvmmsg)
-	_ABI_SYSCALL_SOCK_CHK(sendmmsg)
-
-	return false;
+	sys = arch->syscall_mux_raw(sys);
+	return (sys <= -100 && sys >= -120);
 }
 
 /**
@@ -191,33 +162,12 @@ static bool _abi_syscall_socket_test(const struct arch_def *arch, int sys)
  */
 static bool _abi_syscall_ipc_test(const struct arch_def *arch, int sys)
 {
-	const char *name;
-
 	/* multiplexed pseudo-syscalls */
 	if (sys <= -200 && sys >= -224)
 		return true;
 
-	name = arch->syscall_resolve_num_raw(sys);
-	if (!name)
-		return false;
-
-#define _ABI_SYSCALL_IPC_CHK(NAME) \
-	if (!strcmp(name, #NAME)) return true;
-
-	_ABI_SYSCALL_IPC_CHK(semop)
-	_ABI_SYSCALL_IPC_CHK(semget)
-	_ABI_SYSCALL_IPC_CHK(semctl)
-	_ABI_SYSCALL_IPC_CHK(semtimedop)
-	_ABI_SYSCALL_IPC_CHK(msgsnd)
-	_ABI_SYSCALL_IPC_CHK(msgrcv)
-	_ABI_SYSCALL_IPC_CHK(msgget)
-	_ABI_SYSCALL_IPC_CHK(msgctl)
-	_ABI_SYSCALL_IPC_CHK(shmat)
-	_ABI_SYSCALL_IPC_CHK(shmdt)
-	_ABI_SYSCALL_IPC_CHK(shmget)
-	_ABI_SYSCALL_IPC_CHK(shmctl)
-
-	return false;
+	sys = arch->syscall_mux_raw(sys);
+	return (sys <= -200 && sys >= -224);
 }
 
 /**
@@ -231,57 +181,7 @@ static bool _abi_syscall_ipc_test(const struct arch_def *arch, int sys)
  */
 static int _abi_syscall_demux(const struct arch_def *arch, int syscall)
 {
-	int sys = __NR_SCMP_UNDEF;
-
-#define _ABI_SYSCALL_DEMUX_CHK(NAME) \
-case __PNR_##NAME: \
-	sys = arch->syscall_resolve_name_raw(#NAME); break;
-
-	switch (syscall) {
-		_ABI_SYSCALL_DEMUX_CHK(socket)
-		_ABI_SYSCALL_DEMUX_CHK(bind)
-		_ABI_SYSCALL_DEMUX_CHK(connect)
-		_ABI_SYSCALL_DEMUX_CHK(listen)
-		_ABI_SYSCALL_DEMUX_CHK(accept)
-		_ABI_SYSCALL_DEMUX_CHK(getsockname)
-		_ABI_SYSCALL_DEMUX_CHK(getpeername)
-		_ABI_SYSCALL_DEMUX_CHK(socketpair)
-		_ABI_SYSCALL_DEMUX_CHK(send)
-		_ABI_SYSCALL_DEMUX_CHK(recv)
-		_ABI_SYSCALL_DEMUX_CHK(sendto)
-		_ABI_SYSCALL_DEMUX_CHK(recvfrom)
-		_ABI_SYSCALL_DEMUX_CHK(shutdown)
-		_ABI_SYSCALL_DEMUX_CHK(setsockopt)
-		_ABI_SYSCALL_DEMUX_CHK(getsockopt)
-		_ABI_SYSCALL_DEMUX_CHK(sendmsg)
-		_ABI_SYSCALL_DEMUX_CHK(recvmsg)
-		_ABI_SYSCALL_DEMUX_CHK(accept4)
-		_ABI_SYSCALL_DEMUX_CHK(recvmmsg)
-		_ABI_SYSCALL_DEMUX_CHK(sendmmsg)
-		_ABI_SYSCALL_DEMUX_CHK(semop)
-		_ABI_SYSCALL_DEMUX_CHK(semget)
-		_ABI_SYSCALL_DEMUX_CHK(semctl)
-		_ABI_SYSCALL_DEMUX_CHK(semtimedop)
-		_ABI_SYSCALL_DEMUX_CHK(msgsnd)
-		_ABI_SYSCALL_DEMUX_CHK(msgrcv)
-		_ABI_SYSCALL_DEMUX_CHK(msgget)
-		_ABI_SYSCALL_DEMUX_CHK(msgctl)
-		_ABI_SYSCALL_DEMUX_CHK(shmat)
-		_ABI_SYSCALL_DEMUX_CHK(shmdt)
-		_ABI_SYSCALL_DEMUX_CHK(shmget)
-		_ABI_SYSCALL_DEMUX_CHK(shmctl)
-	}
-
-	/* this looks odd because the arch resolver returns _ERROR if it can't
-	 * resolve the syscall, but we want to use _UNDEF for that, so we set
-	 * 'sys' to a sentinel value of _UNDEF and if it is error here we know
-	 * the resolve failed to find a match */
-	if (sys == __NR_SCMP_UNDEF)
-		sys = __NR_SCMP_ERROR;
-	else if (sys == __NR_SCMP_ERROR)
-		sys = __NR_SCMP_UNDEF;
-
-	return sys;
+	return arch->syscall_demux_raw(syscall);
 }
 
 /**
@@ -295,49 +195,7 @@ case __PNR_##NAME: \
  */
 static int _abi_syscall_mux(const struct arch_def *arch, int syscall)
 {
-	const char *sys;
-
-	sys = arch->syscall_resolve_num_raw(syscall);
-	if (!sys)
-		return __NR_SCMP_ERROR;
-
-#define _ABI_SYSCALL_MUX_CHK(NAME) \
-	if (!strcmp(sys, #NAME)) return __PNR_##NAME;
-
-	_ABI_SYSCALL_MUX_CHK(socket)
-	_ABI_SYSCALL_MUX_CHK(bind)
-	_ABI_SYSCALL_MUX_CHK(connect)
-	_ABI_SYSCALL_MUX_CHK(listen)
-	_ABI_SYSCALL_MUX_CHK(accept)
-	_ABI_SYSCALL_MUX_CHK(getsockname)
-	_ABI_SYSCALL_MUX_CHK(getpeername)
-	_ABI_SYSCALL_MUX_CHK(socketpair)
-	_ABI_SYSCALL_MUX_CHK(send)
-	_ABI_SYSCALL_MUX_CHK(recv)
-	_ABI_SYSCALL_MUX_CHK(sendto)
-	_ABI_SYSCALL_MUX_CHK(recvfrom)
-	_ABI_SYSCALL_MUX_CHK(shutdown)
-	_ABI_SYSCALL_MUX_CHK(setsockopt)
-	_ABI_SYSCALL_MUX_CHK(getsockopt)
-	_ABI_SYSCALL_MUX_CHK(sendmsg)
-	_ABI_SYSCALL_MUX_CHK(recvmsg)
-	_ABI_SYSCALL_MUX_CHK(accept4)
-	_ABI_SYSCALL_MUX_CHK(recvmmsg)
-	_ABI_SYSCALL_MUX_CHK(sendmmsg)
-	_ABI_SYSCALL_MUX_CHK(semop)
-	_ABI_SYSCALL_MUX_CHK(semget)
-	_ABI_SYSCALL_MUX_CHK(semctl)
-	_ABI_SYSCALL_MUX_CHK(semtimedop)
-	_ABI_SYSCALL_MUX_CHK(msgsnd)
-	_ABI_SYSCALL_MUX_CHK(msgrcv)
-	_ABI_SYSCALL_MUX_CHK(msgget)
-	_ABI_SYSCALL_MUX_CHK(msgctl)
-	_ABI_SYSCALL_MUX_CHK(shmat)
-	_ABI_SYSCALL_MUX_CHK(shmdt)
-	_ABI_SYSCALL_MUX_CHK(shmget)
-	_ABI_SYSCALL_MUX_CHK(shmctl)
-
-	return __NR_SCMP_ERROR;
+	return arch->syscall_mux_raw(syscall);
 }
 
 /**
@@ -428,8 +286,10 @@ int abi_rule_add(struct db_filter *db, struct db_api_rule_list *rule)
 			rule_a = rule;
 			rule_dup = db_rule_dup(rule_a);
 			rule_b = rule_dup;
-			if (rule_b == NULL)
+			if (rule_b == NULL) {
+				rc = -ENOMEM;
 				goto add_return;
+			}
 			rule_b->prev = rule_a;
 			rule_b->next = NULL;
 			rule_a->next = rule_b;
@@ -502,8 +362,10 @@ int abi_rule_add(struct db_filter *db, struct db_api_rule_list *rule)
 			rule_a = rule;
 			rule_dup = db_rule_dup(rule_a);
 			rule_b = rule_dup;
-			if (rule_b == NULL)
+			if (rule_b == NULL) {
+				rc = -ENOMEM;
 				goto add_return;
+			}
 			rule_b->prev = rule_a;
 			rule_b->next = NULL;
 			rule_a->next = rule_b;
@@ -546,6 +408,6 @@ int abi_rule_add(struct db_filter *db, struct db_api_rule_list *rule)
 
 add_return:
 	if (rule_dup != NULL)
-		free(rule_dup);
+		zfree(rule_dup);
 	return rc;
 }
@@ -92,6 +92,8 @@ struct arch_syscall_table {
 /* defined in syscalls.perf.template  */
 int syscall_resolve_name(const char *name, int offset);
 const char *syscall_resolve_num(int num, int offset);
+int syscall_resolve_num_mux(int num, int offset);
+int syscall_resolve_mux_num(int num, int offset);
 enum scmp_kver syscall_resolve_name_kver(const char *name, int offset_kver);
 enum scmp_kver syscall_resolve_num_kver(int num,
 					int offset_arch, int offset_kver);
@@ -33,7 +33,7 @@
 #include "arch.h"
 #include "db.h"
 #include "gen_bpf.h"
-#include "helper.h"
+#include "trace.h"
 
 /* NOTE: the seccomp syscall allowlist is currently disabled for testing
  *       purposes, but unless we can verify all of the supported ABIs before
@@ -374,13 +374,16 @@ void sys_set_seccomp_flag(int flag, bool enable)
 int sys_filter_load(struct db_filter_col *col, bool rawrc)
 {
 	int rc;
+	int flgs = 0;
 	bool tsync_notify;
 	bool listener_req;
 	struct bpf_program *prgm = NULL;
 
+	TRACE1(load_entry, col);
+
 	rc = db_col_precompute(col);
 	if (rc < 0)
-		return rc;
+		goto filter_load_return;
 	prgm = col->prgm_bpf;
 
 	/* attempt to set NO_NEW_PRIVS */
@@ -396,7 +399,6 @@ int sys_filter_load(struct db_filter_col *col, bool rawrc)
 
 	/* load the filter into the kernel */
 	if (sys_chk_seccomp_syscall() == 1) {
-		int flgs = 0;
 		if (tsync_notify) {
 			if (col->attr.tsync_enable)
 				flgs |= SECCOMP_FILTER_FLAG_TSYNC | \
@@ -439,10 +441,10 @@ int sys_filter_load(struct db_filter_col *col, bool rawrc)
 
 filter_load_out:
 	/* cleanup and return */
-	if (rc == -ESRCH)
-		return -ESRCH;
-	if (rc < 0)
-		return (rawrc ? -errno : -ECANCELED);
+	if (rc < 0 && rc != -ESRCH)
+		rc = (rawrc ? -errno : -ECANCELED);
+filter_load_return:
+	TRACE3(load_return, col, flgs, rc);
 	return rc;
 }
 
@@ -486,14 +488,16 @@ int sys_notify_alloc(struct seccomp_notif **req,
 	if (sizes.seccomp_notif == 0 || sizes.seccomp_notif_resp == 0)
 		return -EFAULT;
 
+	/* NOTE: these buffers are owned by the caller and may be released with
+	 *       free(3), so they are allocated outside of zmalloc() */
 	if (req) {
-		*req = zmalloc(sizes.seccomp_notif);
+		*req = calloc(1, sizes.seccomp_notif);
 		if (!*req)
 			return -ENOMEM;
 	}
 
 	if (resp) {
-		*resp = zmalloc(sizes.seccomp_notif_resp);
+		*resp = calloc(1, sizes.seccomp_notif_resp);
 		if (!*resp) {
 			if (req)
 				free(*req);
@@ -516,13 +520,17 @@ int sys_notify_alloc(struct seccomp_notif **req,
  */
 int sys_notify_receive(int fd, struct seccomp_notif *req)
 {
+	int rc = 0;
+
 	if (state.sup_user_notif <= 0)
 		return -EOPNOTSUPP;
 
+	TRACE1(notify_receive_entry, fd);
 	if (ioctl(fd, SECCOMP_IOCTL_NOTIF_RECV, req) < 0)
-		return -ECANCELED;
+		rc = -ECANCELED;
+	TRACE3(notify_receive_return, fd, req->id, rc);
 
-	return 0;
+	return rc;
 }
 
 /**
@@ -537,12 +545,16 @@ int sys_notify_receive(int fd, struct seccomp_notif *req)
  */
 int sys_notify_respond(int fd, struct seccomp_notif_resp *resp)
 {
+	int rc = 0;
+
 	if (state.sup_user_notif <= 0)
 		return -EOPNOTSUPP;
 
 	if (ioctl(fd, SECCOMP_IOCTL_NOTIF_SEND, resp) < 0)
-		return -ECANCELED;
-	return 0;
+		rc = -ECANCELED;
+	TRACE3(notify_respond, fd, resp->id, rc);
+
+	return rc;
 }
 
 /**
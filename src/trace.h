@@ -0,0 +1,59 @@
+/**
+ * Seccomp Library USDT Probes
+ *
+ * Copyright (c) 2026 Microsoft Corporation <paulmoore@microsoft.com>
+ * Author: Paul Moore <paul@paul-moore.com>
+ */
+
+/*
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of version 2.1 of the GNU Lesser General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses>.
+ */
+
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include "configure.h"
+
+/*
+ * USDT probes, see the "Tracing the Library" section of README.md for the
+ * list of probes; they are only built when configured with --enable-usdt,
+ * otherwise the probes, and their arguments, compile to nothing.
+ */
+
+#if ENABLE_USDT
+
+#include <sys/sdt.h>
+
+#define TRACE1(name, a1) \
+	DTRACE_PROBE1(libseccomp, name, a1)
+#define TRACE2(name, a1, a2) \
+	DTRACE_PROBE2(libseccomp, name, a1, a2)
+#define TRACE3(name, a1, a2, a3) \
+	DTRACE_PROBE3(libseccomp, name, a1, a2, a3)
+#define TRACE4(name, a1, a2, a3, a4) \
+	DTRACE_PROBE4(libseccomp, name, a1, a2, a3, a4)
+
+#else
+
+#define TRACE1(name, a1) \
+	do { } while (0)
+#define TRACE2(name, a1, a2) \
+	do { } while (0)
+#define TRACE3(name, a1, a2, a3) \
+	do { } while (0)
+#define TRACE4(name, a1, a2, a3, a4) \
+	do { } while (0)
+
+#endif
+
+#endif
@@ -73,6 +73,22 @@ int main(int argc, char *argv[])
 	seccomp_release(ctx);
 	ctx = NULL;
 
+	/* seccomp_syscall_weight errors */
+	rc = seccomp_syscall_weight(ctx, SCMP_SYS(read), 1);
+	if (rc != -EINVAL)
+		return -1;
+
+	ctx = seccomp_init(SCMP_ACT_ALLOW);
+	if (ctx == NULL)
+		return -1;
+	else {
+		rc = seccomp_syscall_weight(ctx, -10, 1);
+		if (rc != -EINVAL)
+			return -1;
+	}
+	seccomp_release(ctx);
+	ctx = NULL;
+
 	/* seccomp_rule_add errors */
 	rc = seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(read), 1,
 			      SCMP_A0(SCMP_CMP_EQ, 0));
@@ -153,6 +153,83 @@ int main(int argc, char *argv[])
 		goto out;
 	}
 
+	rc = seccomp_attr_set(ctx, SCMP_FLTATR_CTL_MINIMIZE, 1);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_attr_get(ctx, SCMP_FLTATR_CTL_MINIMIZE, &val);
+	if (rc != 0)
+		goto out;
+	if (val != 1) {
+		rc = -1;
+		goto out;
+	}
+
+	rc = seccomp_attr_set(ctx, SCMP_FLTATR_STAT_MIN_NODES, 1);
+	if (rc != -EACCES) {
+		rc = -1;
+		goto out;
+	}
+	rc = seccomp_attr_get(ctx, SCMP_FLTATR_STAT_MIN_NODES, &val);
+	if (rc != 0)
+		goto out;
+	if (val != 0) {
+		rc = -1;
+		goto out;
+	}
+
+	rc = seccomp_attr_set(ctx, SCMP_FLTATR_STAT_COST_BEFORE, 1);
+	if (rc != -EACCES) {
+		rc = -1;
+		goto out;
+	}
+	rc = seccomp_attr_set(ctx, SCMP_FLTATR_STAT_COST_AFTER, 1);
+	if (rc != -EACCES) {
+		rc = -1;
+		goto out;
+	}
+	rc = seccomp_attr_get(ctx, SCMP_FLTATR_STAT_COST_AFTER, &val);
+	if (rc != 0)
+		goto out;
+	if (val != 0) {
+		rc = -1;
+		goto out;
+	}
+
+	rc = seccomp_attr_set(ctx, SCMP_FLTATR_CTL_MEM_MAX, 1 << 20);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_attr_get(ctx, SCMP_FLTATR_CTL_MEM_MAX, &val);
+	if (rc != 0)
+		goto out;
+	if (val != 1 << 20) {
+		rc = -1;
+		goto out;
+	}
+
+	rc = seccomp_attr_set(ctx, SCMP_FLTATR_STAT_MEM_USED, 1);
+	if (rc != -EACCES) {
+		rc = -1;
+		goto out;
+	}
+
+	rc = seccomp_attr_set(ctx, SCMP_FLTATR_CTL_CACHE, 1);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_attr_get(ctx, SCMP_FLTATR_CTL_CACHE, &val);
+	if (rc != 0)
+		goto out;
+	if (val != 1) {
+		rc = -1;
+		goto out;
+	}
+	rc = seccomp_attr_get(ctx, SCMP_FLTATR_STAT_MEM_USED, &val);
+	if (rc != 0)
+		goto out;
+	if (val == 0) {
+		rc = -1;
+		goto out;
+	}
+
 	rc = 0;
 out:
 	seccomp_release(ctx);
@@ -64,6 +64,21 @@ def test():
     f.set_attr(Attr.CTL_WAITKILL, 1)
     if f.get_attr(Attr.CTL_WAITKILL) != 1:
         raise RuntimeError("Failed getting Attr.CTL_WAITKILL")
+    f.set_attr(Attr.CTL_MINIMIZE, 1)
+    if f.get_attr(Attr.CTL_MINIMIZE) != 1:
+        raise RuntimeError("Failed getting Attr.CTL_MINIMIZE")
+    if f.get_attr(Attr.STAT_MIN_NODES) != 0:
+        raise RuntimeError("Failed getting Attr.STAT_MIN_NODES")
+    if f.get_attr(Attr.STAT_COST_AFTER) != 0:
+        raise RuntimeError("Failed getting Attr.STAT_COST_AFTER")
+    f.set_attr(Attr.CTL_MEM_MAX, 1 << 20)
+    if f.get_attr(Attr.CTL_MEM_MAX) != 1 << 20:
+        raise RuntimeError("Failed getting Attr.CTL_MEM_MAX")
+    if f.get_attr(Attr.STAT_MEM_USED) == 0:
+        raise RuntimeError("Failed getting Attr.STAT_MEM_USED")
+    f.set_attr(Attr.CTL_CACHE, 1)
+    if f.get_attr(Attr.CTL_CACHE) != 1:
+        raise RuntimeError("Failed getting Attr.CTL_CACHE")
 
 test()
 
@@ -0,0 +1,52 @@
+#!/usr/bin/env python
+
+#
+# Seccomp Library test program
+#
+# Copyright (c) 2026 Microsoft Corporation <paulmoore@microsoft.com>
+# Author: Paul Moore <paul@paul-moore.com>
+#
+
+#
+# This library is free software; you can redistribute it and/or modify it
+# under the terms of version 2.1 of the GNU Lesser General Public License as
+# published by the Free Software Foundation.
+#
+# This library is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+# for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library; if not, see <http://www.gnu.org/licenses>.
+#
+
+import argparse
+import sys
+
+import util
+
+from seccomp import *
+
+def test(args):
+    f = SyscallFilter(KILL)
+    f.remove_arch(Arch())
+    f.add_arch(Arch("x86"))
+    f.add_arch(Arch("x86_64"))
+    for op in [1, 2, 3, 4, 8, 15, 16, 22, 23, 38]:
+        f.add_rule(ALLOW, "prctl", Arg(0, EQ, op))
+    f.add_rule(ERRNO(5), "prctl", Arg(0, EQ, 40))
+    f.add_rule(ERRNO(6), "prctl", Arg(0, GT, 1000))
+    for sc in ["socket", "bind", "connect", "listen", "accept",
+               "getsockname", "getpeername", "socketpair", "send", "recv",
+               "sendto", "recvfrom", "shutdown", "setsockopt", "getsockopt",
+               "sendmsg", "recvmsg"]:
+        f.add_rule(ALLOW, sc)
+    return f
+
+args = util.get_opt()
+ctx = test(args)
+util.filter_output(args, ctx)
+
+# kate: syntax python;
+# kate: indent-mode python; space-indent on; indent-width 4; mixedindent off;
@@ -0,0 +1,44 @@
+#!/usr/bin/env python
+
+#
+# Seccomp Library test program
+#
+# Copyright (c) 2026 Microsoft Corporation <paulmoore@microsoft.com>
+# Author: Paul Moore <paul@paul-moore.com>
+#
+
+#
+# This library is free software; you can redistribute it and/or modify it
+# under the terms of version 2.1 of the GNU Lesser General Public License as
+# published by the Free Software Foundation.
+#
+# This library is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+# for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library; if not, see <http://www.gnu.org/licenses>.
+#
+
+import argparse
+import sys
+
+import util
+
+from seccomp import *
+
+def test(args):
+    f = SyscallFilter(KILL)
+    f.remove_arch(Arch())
+    f.add_arch(Arch("x86_64"))
+    for req in [0x5401, 0x5402, 0x5403]:
+        f.add_rule(ALLOW, "ioctl", Arg(1, EQ, req))
+    f.add_rule(ALLOW, "ioctl", Arg(1, MASKED_EQ, 0xffffffff0000ffff, 0x5413))
+    f.add_rule(ERRNO(1), "ioctl", Arg(1, MASKED_EQ, 0xff, 0x7f))
+    f.add_rule(ERRNO(2), "ioctl", Arg(1, EQ, 0x100000000))
+    return f
+
+args = util.get_opt()
+ctx = test(args)
+util.filter_output(args, ctx)
@@ -0,0 +1,116 @@
+/**
+ * Seccomp Library test program
+ *
+ * Copyright (c) 2026 Microsoft Corporation <paulmoore@microsoft.com>
+ * Author: Paul Moore <paul@paul-moore.com>
+ */
+
+/*
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of version 2.1 of the GNU Lesser General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses>.
+ */
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <seccomp.h>
+
+#include "util.h"
+
+int main(int argc, char *argv[])
+{
+	int rc;
+	uint32_t val;
+	struct util_options opts;
+	scmp_filter_ctx ctx = NULL;
+
+	rc = util_getopt(argc, argv, &opts);
+	if (rc < 0)
+		goto out;
+
+	ctx = seccomp_init(SCMP_ACT_KILL);
+	if (ctx == NULL)
+		return ENOMEM;
+
+	rc = seccomp_arch_remove(ctx, SCMP_ARCH_NATIVE);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_arch_add(ctx, SCMP_ARCH_X86_64);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_attr_set(ctx, SCMP_FLTATR_CTL_MINIMIZE, 1);
+	if (rc != 0)
+		goto out;
+
+	rc = seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(read), 0);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(write), 0);
+	if (rc != 0)
+		goto out;
+
+	/* overlapping ranges */
+	rc = seccomp_rule_add(ctx, SCMP_ACT_ERRNO(2), SCMP_SYS(prctl), 1,
+			      SCMP_A0(SCMP_CMP_GE, 10));
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx, SCMP_ACT_ERRNO(2), SCMP_SYS(prctl), 1,
+			      SCMP_A0(SCMP_CMP_GE, 5));
+	if (rc != 0)
+		goto out;
+
+	/* masked equality covered by a broader mask */
+	rc = seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(ioctl), 1,
+			      SCMP_A1(SCMP_CMP_MASKED_EQ, 0xff, 3));
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(ioctl), 1,
+			      SCMP_A1(SCMP_CMP_MASKED_EQ, 0x0f, 3));
+	if (rc != 0)
+		goto out;
+
+	/* equality covered by a range */
+	rc = seccomp_rule_add(ctx, SCMP_ACT_ERRNO(3), SCMP_SYS(close), 1,
+			      SCMP_A0(SCMP_CMP_EQ, 200));
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx, SCMP_ACT_ERRNO(3), SCMP_SYS(close), 1,
+			      SCMP_A0(SCMP_CMP_GT, 100));
+	if (rc != 0)
+		goto out;
+
+	rc = seccomp_precompute(ctx);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_attr_get(ctx, SCMP_FLTATR_STAT_MIN_NODES, &val);
+	if (rc != 0)
+		goto out;
+	if (val == 0) {
+		rc = -1;
+		goto out;
+	}
+	rc = seccomp_attr_get(ctx, SCMP_FLTATR_STAT_MIN_INSNS, &val);
+	if (rc != 0)
+		goto out;
+	if (val == 0) {
+		rc = -1;
+		goto out;
+	}
+
+	rc = util_filter_output(&opts, ctx);
+	if (rc)
+		goto out;
+
+out:
+	seccomp_release(ctx);
+	return (rc < 0 ? -rc : rc);
+}
@@ -0,0 +1,58 @@
+#!/usr/bin/env python
+
+#
+# Seccomp Library test program
+#
+# Copyright (c) 2026 Microsoft Corporation <paulmoore@microsoft.com>
+# Author: Paul Moore <paul@paul-moore.com>
+#
+
+#
+# This library is free software; you can redistribute it and/or modify it
+# under the terms of version 2.1 of the GNU Lesser General Public License as
+# published by the Free Software Foundation.
+#
+# This library is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+# for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library; if not, see <http://www.gnu.org/licenses>.
+#
+
+import argparse
+import sys
+
+import util
+
+from seccomp import *
+
+def test(args):
+    f = SyscallFilter(KILL)
+    f.remove_arch(Arch())
+    f.add_arch(Arch("x86_64"))
+    used = f.get_attr(Attr.STAT_MEM_USED)
+    if used == 0:
+        raise RuntimeError("Failed getting Attr.STAT_MEM_USED")
+    f.add_rule(ALLOW, "read")
+    f.add_rule(ALLOW, "write")
+    if f.get_attr(Attr.STAT_MEM_USED) <= used:
+        raise RuntimeError("Failed accounting rule memory")
+    used = f.get_attr(Attr.STAT_MEM_USED)
+    f.set_attr(Attr.CTL_MEM_MAX, used + 64)
+    try:
+        f.add_rule(ERRNO(5), "close", Arg(0, EQ, 1))
+    except RuntimeError:
+        pass
+    else:
+        raise RuntimeError("Failed enforcing Attr.CTL_MEM_MAX")
+    if f.get_attr(Attr.STAT_MEM_USED) > used:
+        raise RuntimeError("Failed releasing memory after an error")
+    f.set_attr(Attr.CTL_MEM_MAX, 0)
+    f.add_rule(ERRNO(5), "close", Arg(0, EQ, 1))
+    return f
+
+args = util.get_opt()
+ctx = test(args)
+util.filter_output(args, ctx)
@@ -0,0 +1,160 @@
+/**
+ * Seccomp Library test program
+ *
+ * Copyright (c) 2026 Microsoft Corporation <paulmoore@microsoft.com>
+ * Author: Paul Moore <paul@paul-moore.com>
+ */
+
+/*
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of version 2.1 of the GNU Lesser General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses>.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <seccomp.h>
+
+#include "util.h"
+
+/* CAP_SYS_ADMIN */
+#define CAPS		(1ULL << 21)
+
+static const char *profile =
+	"{\n"
+	"	\"defaultAction\": \"SCMP_ACT_ERRNO\",\n"
+	"	\"defaultErrnoRet\": 1,\n"
+	"	\"architectures\": [ \"SCMP_ARCH_X86_64\", \"SCMP_ARCH_X86\" ],\n"
+	"	\"comment\": \"ignored \\\"text\\\" \\u00e9\",\n"
+	"	\"syscalls\": [\n"
+	"		{ \"names\": [ \"read\", \"write\", \"close\",\n"
+	"			       \"no_such_syscall\" ],\n"
+	"		  \"action\": \"SCMP_ACT_ALLOW\" },\n"
+	"		{ \"names\": [ \"exit_group\" ],\n"
+	"		  \"action\": \"SCMP_ACT_ERRNO\" },\n"
+	"		{ \"name\": \"getppid\",\n"
+	"		  \"action\": \"SCMP_ACT_ERRNO\", \"errnoRet\": 5 },\n"
+	"		{ \"names\": [ \"personality\" ],\n"
+	"		  \"action\": \"SCMP_ACT_ALLOW\",\n"
+	"		  \"args\": [\n"
+	"			{ \"index\": 0, \"value\": 0,\n"
+	"			  \"op\": \"SCMP_CMP_EQ\" },\n"
+	"			{ \"index\": 0, \"value\": 8,\n"
+	"			  \"op\": \"SCMP_CMP_EQ\" } ] },\n"
+	"		{ \"names\": [ \"fcntl\" ],\n"
+	"		  \"action\": \"SCMP_ACT_ALLOW\",\n"
+	"		  \"args\": [\n"
+	"			{ \"index\": 1, \"value\": 1,\n"
+	"			  \"op\": \"SCMP_CMP_EQ\" },\n"
+	"			{ \"index\": 2, \"value\": 3, \"valueTwo\": 0,\n"
+	"			  \"op\": \"SCMP_CMP_MASKED_EQ\" } ] },\n"
+	"		{ \"names\": [ \"mount\" ],\n"
+	"		  \"action\": \"SCMP_ACT_ALLOW\",\n"
+	"		  \"includes\": { \"caps\": [ \"CAP_SYS_ADMIN\" ] } },\n"
+	"		{ \"names\": [ \"reboot\" ],\n"
+	"		  \"action\": \"SCMP_ACT_ALLOW\",\n"
+	"		  \"includes\": { \"caps\": [ \"CAP_SYS_BOOT\" ] } },\n"
+	"		{ \"names\": [ \"clone\" ],\n"
+	"		  \"action\": \"SCMP_ACT_ALLOW\",\n"
+	"		  \"excludes\": { \"caps\": [ \"CAP_SYS_ADMIN\" ] } },\n"
+	"		{ \"names\": [ \"fstat\" ],\n"
+	"		  \"action\": \"SCMP_ACT_ALLOW\",\n"
+	"		  \"includes\": { \"minKernel\": \"1.0\" } },\n"
+	"		{ \"names\": [ \"lstat\" ],\n"
+	"		  \"action\": \"SCMP_ACT_ALLOW\",\n"
+	"		  \"includes\": { \"minKernel\": \"999.0\" } },\n"
+	"		{ \"names\": [ \"stat\" ],\n"
+	"		  \"action\": \"SCMP_ACT_ALLOW\",\n"
+	"		  \"excludes\": { \"minKernel\": \"999.0\" } },\n"
+	"		{ \"names\": [ \"brk\" ],\n"
+	"		  \"action\": \"SCMP_ACT_ALLOW\",\n"
+	"		  \"includes\": { \"arches\": [ \"no_such_arch\" ] } }\n"
+	"	]\n"
+	"}\n";
+
+int main(int argc, char *argv[])
+{
+	int rc;
+	struct util_options opts;
+	scmp_filter_ctx ctx = NULL;
+	struct scmp_rule rules[2];
+
+	rc = util_getopt(argc, argv, &opts);
+	if (rc < 0)
+		goto out;
+
+	ctx = seccomp_init(SCMP_ACT_KILL);
+	if (ctx == NULL)
+		return ENOMEM;
+
+	rc = seccomp_arch_remove(ctx, SCMP_ARCH_NATIVE);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_arch_add(ctx, SCMP_ARCH_X86_64);
+	if (rc != 0)
+		goto out;
+
+	/* malformed profiles must leave the filter untouched */
+	rc = seccomp_import_oci(ctx, profile, strlen(profile) / 2, CAPS);
+	if (rc != -EINVAL) {
+		rc = -1;
+		goto out;
+	}
+	rc = seccomp_import_oci(ctx, "{ \"defaultAction\": \"SCMP_ACT_FOO\" }",
+				36, CAPS);
+	if (rc != -EINVAL) {
+		rc = -1;
+		goto out;
+	}
+
+	rc = seccomp_import_oci(ctx, profile, strlen(profile), CAPS);
+	if (rc != 0)
+		goto out;
+
+	/* profiles can only be loaded into an empty filter */
+	rc = seccomp_import_oci(ctx, profile, strlen(profile), CAPS);
+	if (rc != -EEXIST) {
+		rc = -1;
+		goto out;
+	}
+
+	/* a batch is added in full or not at all */
+	rules[0].action = SCMP_ACT_ALLOW;
+	rules[0].syscall = SCMP_SYS(munmap);
+	rules[0].arg_cnt = 0;
+	rules[0].arg_array = NULL;
+	rules[1].action = SCMP_ACT_ERRNO(1);
+	rules[1].syscall = SCMP_SYS(rt_sigreturn);
+	rules[1].arg_cnt = 0;
+	rules[1].arg_array = NULL;
+	rc = seccomp_rule_add_batch(ctx, rules, 2);
+	if (rc != -EACCES) {
+		rc = -1;
+		goto out;
+	}
+	rc = seccomp_rule_add_batch(ctx, &rules[1], 0);
+	if (rc != 0)
+		goto out;
+	rules[1].action = SCMP_ACT_ALLOW;
+	rc = seccomp_rule_add_batch(ctx, &rules[1], 1);
+	if (rc != 0)
+		goto out;
+
+	rc = util_filter_output(&opts, ctx);
+	if (rc)
+		goto out;
+
+out:
+	seccomp_release(ctx);
+	return (rc < 0 ? -rc : rc);
+}
@@ -0,0 +1,116 @@
+#!/usr/bin/env python
+
+#
+# Seccomp Library test program
+#
+# Copyright (c) 2026 Microsoft Corporation <paulmoore@microsoft.com>
+# Author: Paul Moore <paul@paul-moore.com>
+#
+
+#
+# This library is free software; you can redistribute it and/or modify it
+# under the terms of version 2.1 of the GNU Lesser General Public License as
+# published by the Free Software Foundation.
+#
+# This library is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+# for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library; if not, see <http://www.gnu.org/licenses>.
+#
+
+import argparse
+import sys
+
+import util
+
+from seccomp import *
+
+# CAP_SYS_ADMIN
+CAPS = 1 << 21
+
+PROFILE = """
+{
+	"defaultAction": "SCMP_ACT_ERRNO",
+	"defaultErrnoRet": 1,
+	"architectures": [ "SCMP_ARCH_X86_64", "SCMP_ARCH_X86" ],
+	"comment": "ignored \\"text\\" \\u00e9",
+	"syscalls": [
+		{ "names": [ "read", "write", "close",
+			     "no_such_syscall" ],
+		  "action": "SCMP_ACT_ALLOW" },
+		{ "names": [ "exit_group" ],
+		  "action": "SCMP_ACT_ERRNO" },
+		{ "name": "getppid",
+		  "action": "SCMP_ACT_ERRNO", "errnoRet": 5 },
+		{ "names": [ "personality" ],
+		  "action": "SCMP_ACT_ALLOW",
+		  "args": [
+			{ "index": 0, "value": 0,
+			  "op": "SCMP_CMP_EQ" },
+			{ "index": 0, "value": 8,
+			  "op": "SCMP_CMP_EQ" } ] },
+		{ "names": [ "fcntl" ],
+		  "action": "SCMP_ACT_ALLOW",
+		  "args": [
+			{ "index": 1, "value": 1,
+			  "op": "SCMP_CMP_EQ" },
+			{ "index": 2, "value": 3, "valueTwo": 0,
+			  "op": "SCMP_CMP_MASKED_EQ" } ] },
+		{ "names": [ "mount" ],
+		  "action": "SCMP_ACT_ALLOW",
+		  "includes": { "caps": [ "CAP_SYS_ADMIN" ] } },
+		{ "names": [ "reboot" ],
+		  "action": "SCMP_ACT_ALLOW",
+		  "includes": { "caps": [ "CAP_SYS_BOOT" ] } },
+		{ "names": [ "clone" ],
+		  "action": "SCMP_ACT_ALLOW",
+		  "excludes": { "caps": [ "CAP_SYS_ADMIN" ] } },
+		{ "names": [ "fstat" ],
+		  "action": "SCMP_ACT_ALLOW",
+		  "includes": { "minKernel": "1.0" } },
+		{ "names": [ "lstat" ],
+		  "action": "SCMP_ACT_ALLOW",
+		  "includes": { "minKernel": "999.0" } },
+		{ "names": [ "stat" ],
+		  "action": "SCMP_ACT_ALLOW",
+		  "excludes": { "minKernel": "999.0" } },
+		{ "names": [ "brk" ],
+		  "action": "SCMP_ACT_ALLOW",
+		  "includes": { "arches": [ "no_such_arch" ] } }
+	]
+}
+"""
+
+def test(args):
+    f = SyscallFilter(KILL)
+    f.remove_arch(Arch())
+    f.add_arch(Arch("x86_64"))
+    try:
+        f.import_oci(PROFILE[:len(PROFILE) // 2], CAPS)
+    except ValueError:
+        pass
+    else:
+        raise RuntimeError("Failed rejecting a malformed profile")
+    f.import_oci(PROFILE, CAPS)
+    try:
+        f.import_oci(PROFILE, CAPS)
+    except RuntimeError:
+        pass
+    else:
+        raise RuntimeError("Failed rejecting a non-empty filter")
+    try:
+        f.add_rules([(ALLOW, "munmap"), (ERRNO(1), "rt_sigreturn")])
+    except RuntimeError:
+        pass
+    else:
+        raise RuntimeError("Failed rejecting a rule with the default action")
+    f.add_rules([])
+    f.add_rules([(ALLOW, "rt_sigreturn")])
+    return f
+
+args = util.get_opt()
+ctx = test(args)
+util.filter_output(args, ctx)
@@ -0,0 +1,164 @@
+/**
+ * Seccomp Library test program
+ *
+ * Copyright (c) 2026 Microsoft Corporation <paulmoore@microsoft.com>
+ * Author: Paul Moore <paul@paul-moore.com>
+ */
+
+/*
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of version 2.1 of the GNU Lesser General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses>.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <seccomp.h>
+
+#include "util.h"
+
+int main(int argc, char *argv[])
+{
+	int rc;
+	uint32_t val;
+	size_t len = 0, len_tmp;
+	unsigned char *img = NULL;
+	struct util_options opts;
+	scmp_filter_ctx ctx = NULL;
+	scmp_filter_ctx ctx_src = NULL;
+
+	rc = util_getopt(argc, argv, &opts);
+	if (rc < 0)
+		goto out;
+
+	ctx_src = seccomp_init(SCMP_ACT_KILL);
+	if (ctx_src == NULL)
+		return ENOMEM;
+
+	rc = seccomp_arch_remove(ctx_src, SCMP_ARCH_NATIVE);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_arch_add(ctx_src, SCMP_ARCH_X86_64);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_arch_add(ctx_src, SCMP_ARCH_X86);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_attr_set(ctx_src, SCMP_FLTATR_ACT_BADARCH,
+			      SCMP_ACT_ERRNO(9));
+	if (rc != 0)
+		goto out;
+
+	rc = seccomp_syscall_priority(ctx_src, SCMP_SYS(write), 100);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx_src, SCMP_ACT_ALLOW, SCMP_SYS(read), 0);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx_src, SCMP_ACT_ALLOW, SCMP_SYS(write), 1,
+			      SCMP_A0(SCMP_CMP_EQ, 1));
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx_src, SCMP_ACT_ERRNO(1), SCMP_SYS(write), 2,
+			      SCMP_A0(SCMP_CMP_EQ, 2),
+			      SCMP_A2(SCMP_CMP_GT, 0x100000000ULL));
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx_src, SCMP_ACT_ERRNO(2), SCMP_SYS(close), 1,
+			      SCMP_A0(SCMP_CMP_MASKED_EQ, 0xf0, 0x10));
+	if (rc != 0)
+		goto out;
+	rc = seccomp_rule_add(ctx_src, SCMP_ACT_ERRNO(3), SCMP_SYS(socket), 1,
+			      SCMP_A0(SCMP_CMP_EQ, 2));
+	if (rc != 0)
+		goto out;
+
+	/* export the rule database */
+	rc = seccomp_export_db(ctx_src, NULL, &len);
+	if (rc != 0)
+		goto out;
+	img = malloc(len);
+	if (img == NULL) {
+		rc = ENOMEM;
+		goto out;
+	}
+	len_tmp = len - 1;
+	rc = seccomp_export_db(ctx_src, img, &len_tmp);
+	if (rc != -ERANGE || len_tmp != len) {
+		rc = -1;
+		goto out;
+	}
+	rc = seccomp_export_db(ctx_src, img, &len);
+	if (rc != 0)
+		goto out;
+	seccomp_release(ctx_src);
+	ctx_src = NULL;
+
+	/* import it into a filter with different settings */
+	ctx = seccomp_init(SCMP_ACT_ERRNO(6));
+	if (ctx == NULL) {
+		rc = ENOMEM;
+		goto out;
+	}
+	rc = seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(open), 0);
+	if (rc != 0)
+		goto out;
+
+	/* damaged images must be rejected without touching the filter */
+	rc = seccomp_import_db(ctx, img, len - 1);
+	if (rc != -EINVAL) {
+		rc = -1;
+		goto out;
+	}
+	img[0] ^= 0xff;
+	rc = seccomp_import_db(ctx, img, len);
+	if (rc != -EINVAL) {
+		rc = -1;
+		goto out;
+	}
+	img[0] ^= 0xff;
+	rc = seccomp_attr_get(ctx, SCMP_FLTATR_ACT_DEFAULT, &val);
+	if (rc != 0)
+		goto out;
+	if (val != SCMP_ACT_ERRNO(6)) {
+		rc = -1;
+		goto out;
+	}
+
+	rc = seccomp_import_db(ctx, img, len);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_attr_get(ctx, SCMP_FLTATR_ACT_BADARCH, &val);
+	if (rc != 0)
+		goto out;
+	if (val != SCMP_ACT_ERRNO(9)) {
+		rc = -1;
+		goto out;
+	}
+
+	/* the imported filter must still accept new rules */
+	rc = seccomp_rule_add(ctx, SCMP_ACT_ERRNO(4), SCMP_SYS(close), 1,
+			      SCMP_A0(SCMP_CMP_EQ, 0));
+	if (rc != 0)
+		goto out;
+
+	rc = util_filter_output(&opts, ctx);
+	if (rc)
+		goto out;
+
+out:
+	free(img);
+	seccomp_release(ctx_src);
+	seccomp_release(ctx);
+	return (rc < 0 ? -rc : rc);
+}
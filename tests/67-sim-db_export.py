@@ -0,0 +1,64 @@
+#!/usr/bin/env python
+
+#
+# Seccomp Library test program
+#
+# Copyright (c) 2026 Microsoft Corporation <paulmoore@microsoft.com>
+# Author: Paul Moore <paul@paul-moore.com>
+#
+
+#
+# This library is free software; you can redistribute it and/or modify it
+# under the terms of version 2.1 of the GNU Lesser General Public License as
+# published by the Free Software Foundation.
+#
+# This library is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+# for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library; if not, see <http://www.gnu.org/licenses>.
+#
+
+import argparse
+import sys
+
+import util
+
+from seccomp import *
+
+def test(args):
+    src = SyscallFilter(KILL)
+    src.remove_arch(Arch())
+    src.add_arch(Arch("x86_64"))
+    src.add_arch(Arch("x86"))
+    src.set_attr(Attr.ACT_BADARCH, ERRNO(9))
+    src.syscall_priority("write", 100)
+    src.add_rule(ALLOW, "read")
+    src.add_rule(ALLOW, "write", Arg(0, EQ, 1))
+    src.add_rule(ERRNO(1), "write", Arg(0, EQ, 2), Arg(2, GT, 0x100000000))
+    src.add_rule(ERRNO(2), "close", Arg(0, MASKED_EQ, 0xf0, 0x10))
+    src.add_rule(ERRNO(3), "socket", Arg(0, EQ, 2))
+    img = src.export_db()
+    del src
+
+    f = SyscallFilter(ERRNO(6))
+    f.add_rule(ALLOW, "open")
+    try:
+        f.import_db(img[:-1])
+    except ValueError:
+        pass
+    else:
+        raise RuntimeError("Failed rejecting a truncated image")
+    if f.get_attr(Attr.ACT_DEFAULT) != ERRNO(6):
+        raise RuntimeError("Failed import changed the filter")
+    f.import_db(img)
+    if f.get_attr(Attr.ACT_BADARCH) != ERRNO(9):
+        raise RuntimeError("Failed importing Attr.ACT_BADARCH")
+    f.add_rule(ERRNO(4), "close", Arg(0, EQ, 0))
+    return f
+
+args = util.get_opt()
+ctx = test(args)
+util.filter_output(args, ctx)
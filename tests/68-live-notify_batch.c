@@ -0,0 +1,142 @@
+/**
+ * Seccomp Library test program
+ *
+ * Copyright (c) 2026 Microsoft Corporation <paulmoore@microsoft.com>
+ * Author: Paul Moore <paul@paul-moore.com>
+ */
+
+/*
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of version 2.1 of the GNU Lesser General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses>.
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <asm/unistd.h>
+#include <seccomp.h>
+
+#include "util.h"
+
+#define CHILD_CNT	4
+
+int main(int argc, char *argv[])
+{
+	int rc, fd = -1, status;
+	unsigned int iter, cnt = 0;
+	struct seccomp_notif *req = NULL;
+	struct seccomp_notif_resp *resp = NULL;
+	struct pollfd pfd;
+	scmp_filter_ctx ctx = NULL;
+	pid_t pids[CHILD_CNT] = { 0 }, magic;
+
+	magic = getpid() + 1;
+
+	ctx = seccomp_init(SCMP_ACT_ALLOW);
+	if (ctx == NULL)
+		return ENOMEM;
+
+	rc = seccomp_rule_add(ctx, SCMP_ACT_NOTIFY, SCMP_SYS(getppid), 0);
+	if (rc)
+		goto out;
+
+	rc = seccomp_load(ctx);
+	if (rc < 0)
+		goto out;
+
+	rc = seccomp_notify_fd(ctx);
+	if (rc < 0)
+		goto out;
+	fd = rc;
+
+	for (iter = 0; iter < CHILD_CNT; iter++) {
+		pids[iter] = fork();
+		if (pids[iter] == 0)
+			exit(syscall(__NR_getppid) != magic);
+	}
+
+	rc = seccomp_notify_alloc(&req, &resp);
+	if (rc)
+		goto out;
+
+	/* drain each batch of pending notifications reusing one buffer */
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	while (cnt < CHILD_CNT) {
+		pfd.revents = 0;
+		if (poll(&pfd, 1, -1) < 0) {
+			rc = -errno;
+			goto out;
+		}
+		if (!(pfd.revents & POLLIN))
+			continue;
+
+		memset(req, 0, sizeof(*req));
+		rc = seccomp_notify_receive(fd, req);
+		if (rc)
+			goto out;
+		if (req->data.nr != __NR_getppid) {
+			rc = -EFAULT;
+			goto out;
+		}
+
+		resp->id = req->id;
+		resp->val = magic;
+		resp->error = 0;
+		resp->flags = 0;
+		rc = seccomp_notify_respond(fd, resp);
+		if (rc)
+			goto out;
+		cnt++;
+	}
+
+	for (iter = 0; iter < CHILD_CNT; iter++) {
+		if (waitpid(pids[iter], &status, 0) != pids[iter]) {
+			rc = -EFAULT;
+			goto out;
+		}
+		pids[iter] = 0;
+		if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+			rc = -EFAULT;
+			goto out;
+		}
+	}
+
+	/* nothing should be left pending */
+	pfd.revents = 0;
+	rc = poll(&pfd, 1, 0);
+	if (rc < 0) {
+		rc = -errno;
+		goto out;
+	}
+	rc = (pfd.revents & POLLIN ? -EFAULT : 0);
+
+out:
+	if (fd >= 0)
+		close(fd);
+	for (iter = 0; iter < CHILD_CNT; iter++) {
+		if (pids[iter] > 0)
+			kill(pids[iter], SIGKILL);
+	}
+	seccomp_notify_free(req, resp);
+	seccomp_release(ctx);
+
+	if (rc != 0)
+		return (rc < 0 ? -rc : rc);
+	return 160;
+}
@@ -0,0 +1,74 @@
+#!/usr/bin/env python
+
+#
+# Seccomp Library test program
+#
+# Copyright (c) 2026 Microsoft Corporation <paulmoore@microsoft.com>
+# Author: Paul Moore <paul@paul-moore.com>
+#
+
+#
+# This library is free software; you can redistribute it and/or modify it
+# under the terms of version 2.1 of the GNU Lesser General Public License as
+# published by the Free Software Foundation.
+#
+# This library is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+# for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library; if not, see <http://www.gnu.org/licenses>.
+#
+
+import os
+import signal
+import sys
+
+import util
+
+from seccomp import *
+
+CHILD_CNT = 4
+
+def test():
+    magic = os.getpid() + 1
+    f = SyscallFilter(ALLOW)
+    f.add_rule(NOTIFY, "getppid")
+    f.load()
+    pids = []
+    for i in range(CHILD_CNT):
+        pid = os.fork()
+        if pid == 0:
+            os._exit(0 if os.getppid() == magic else 1)
+        pids.append(pid)
+    try:
+        cnt = 0
+        while cnt < CHILD_CNT:
+            notifys = f.receive_notify_batch(CHILD_CNT)
+            if len(notifys) == 0:
+                raise RuntimeError("Blocking receive returned nothing")
+            for notify in notifys:
+                if notify.syscall != resolve_syscall(Arch(), "getppid"):
+                    raise RuntimeError("Notification failed")
+            f.respond_notify_batch([NotificationResponse(n, magic, 0, 0)
+                                    for n in notifys])
+            cnt += len(notifys)
+        for pid in pids:
+            wpid, rc = os.waitpid(pid, 0)
+            if os.WIFEXITED(rc) == 0:
+                raise RuntimeError("Child process error")
+            if os.WEXITSTATUS(rc) != 0:
+                raise RuntimeError("Child process error")
+        pids = []
+        if f.receive_notify_batch(CHILD_CNT, False) != []:
+            raise RuntimeError("Non-blocking receive returned a notification")
+    finally:
+        for pid in pids:
+            os.kill(pid, signal.SIGKILL)
+    quit(160)
+
+test()
+
+# kate: syntax python;
+# kate: indent-mode python; space-indent on; indent-width 4; mixedindent off;
@@ -0,0 +1,240 @@
+/**
+ * Seccomp Library test program
+ *
+ * Copyright (c) 2026 Microsoft Corporation <paulmoore@microsoft.com>
+ * Author: Paul Moore <paul@paul-moore.com>
+ */
+
+/*
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of version 2.1 of the GNU Lesser General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses>.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include <seccomp.h>
+
+#include "util.h"
+
+struct counter {
+	unsigned long allocs;
+	unsigned long reallocs;
+	unsigned long frees;
+};
+
+static void *cnt_malloc(size_t size, void *data)
+{
+	struct counter *cnt = data;
+	void *ptr;
+
+	ptr = malloc(size);
+	if (ptr != NULL)
+		cnt->allocs++;
+	return ptr;
+}
+
+static void *cnt_realloc(void *ptr, size_t size, void *data)
+{
+	struct counter *cnt = data;
+	void *new;
+
+	new = realloc(ptr, size);
+	if (new != NULL)
+		cnt->reallocs++;
+	return new;
+}
+
+static void cnt_free(void *ptr, void *data)
+{
+	struct counter *cnt = data;
+
+	if (ptr != NULL)
+		cnt->frees++;
+	free(ptr);
+}
+
+static int filter_build(scmp_filter_ctx ctx)
+{
+	int rc;
+	size_t len = 0;
+	char *pfc = NULL;
+
+	rc = seccomp_rule_add(ctx, SCMP_ACT_ERRNO(1), SCMP_SYS(read), 1,
+			      SCMP_A0(SCMP_CMP_EQ, 0));
+	if (rc < 0)
+		return rc;
+	rc = seccomp_rule_add(ctx, SCMP_ACT_ERRNO(2), SCMP_SYS(write), 2,
+			      SCMP_A0(SCMP_CMP_GT, 2),
+			      SCMP_A1(SCMP_CMP_NE, 0));
+	if (rc < 0)
+		return rc;
+	rc = seccomp_rule_add(ctx, SCMP_ACT_KILL, SCMP_SYS(socket), 0);
+	if (rc < 0)
+		return rc;
+	rc = seccomp_precompute(ctx);
+	if (rc < 0)
+		return rc;
+	rc = seccomp_export_bpf_mem(ctx, NULL, &len);
+	if (rc < 0)
+		return rc;
+	if (len == 0)
+		return -EFAULT;
+
+	/* memory returned to the caller always comes from the C library */
+	rc = seccomp_export_pfc_mem(ctx, &pfc, &len);
+	free(pfc);
+	return rc;
+}
+
+static int filter_arches(scmp_filter_ctx ctx, uint32_t arch)
+{
+	int rc;
+
+	rc = seccomp_arch_remove(ctx, SCMP_ARCH_NATIVE);
+	if (rc < 0)
+		return rc;
+	return seccomp_arch_add(ctx, arch);
+}
+
+int main(int argc, char *argv[])
+{
+	int rc;
+	struct counter cnt_proc = { 0 }, cnt_ctx = { 0 }, cnt_src = { 0 };
+	struct scmp_allocator alloc_proc = {
+		.malloc_fn = cnt_malloc,
+		.realloc_fn = cnt_realloc,
+		.free_fn = cnt_free,
+		.data = &cnt_proc,
+	};
+	struct scmp_allocator alloc_ctx = alloc_proc;
+	struct scmp_allocator alloc_src = alloc_proc;
+	struct scmp_allocator alloc_bad = alloc_proc;
+	scmp_filter_ctx ctx = NULL, ctx_src = NULL;
+
+	alloc_ctx.data = &cnt_ctx;
+	alloc_src.data = &cnt_src;
+	alloc_bad.realloc_fn = NULL;
+
+	/* incomplete allocators are rejected */
+	rc = seccomp_set_allocator(NULL, &alloc_bad);
+	if (rc != -EINVAL) {
+		rc = -EFAULT;
+		goto out;
+	}
+
+	/* process-wide allocator */
+	rc = seccomp_set_allocator(NULL, &alloc_proc);
+	if (rc < 0)
+		goto out;
+	ctx = seccomp_init(SCMP_ACT_ALLOW);
+	if (ctx == NULL) {
+		rc = -ENOMEM;
+		goto out;
+	}
+	rc = filter_build(ctx);
+	if (rc < 0)
+		goto out;
+	seccomp_release(ctx);
+	ctx = NULL;
+	if (cnt_proc.allocs == 0 || cnt_proc.allocs != cnt_proc.frees) {
+		rc = -EFAULT;
+		goto out;
+	}
+
+	/* filter context allocator, changed while the filter is in use */
+	ctx = seccomp_init(SCMP_ACT_ALLOW);
+	if (ctx == NULL) {
+		rc = -ENOMEM;
+		goto out;
+	}
+	rc = seccomp_set_allocator(ctx, &alloc_bad);
+	if (rc != -EINVAL) {
+		rc = -EFAULT;
+		goto out;
+	}
+	rc = filter_arches(ctx, SCMP_ARCH_X86_64);
+	if (rc < 0)
+		goto out;
+	rc = seccomp_set_allocator(ctx, &alloc_ctx);
+	if (rc < 0)
+		goto out;
+	rc = filter_build(ctx);
+	if (rc < 0)
+		goto out;
+	if (cnt_ctx.allocs == 0) {
+		rc = -EFAULT;
+		goto out;
+	}
+	rc = seccomp_set_allocator(ctx, NULL);
+	if (rc < 0)
+		goto out;
+	rc = seccomp_rule_add(ctx, SCMP_ACT_ERRNO(3), SCMP_SYS(close), 0);
+	if (rc < 0)
+		goto out;
+	rc = seccomp_set_allocator(ctx, &alloc_ctx);
+	if (rc < 0)
+		goto out;
+
+	/* merged filter contexts keep their memory, and allocators */
+	ctx_src = seccomp_init(SCMP_ACT_ALLOW);
+	if (ctx_src == NULL) {
+		rc = -ENOMEM;
+		goto out;
+	}
+	rc = filter_arches(ctx_src, SCMP_ARCH_AARCH64);
+	if (rc < 0)
+		goto out;
+	rc = seccomp_set_allocator(ctx_src, &alloc_src);
+	if (rc < 0)
+		goto out;
+	rc = filter_build(ctx_src);
+	if (rc < 0)
+		goto out;
+	rc = seccomp_merge(ctx, ctx_src);
+	if (rc < 0)
+		goto out;
+	ctx_src = NULL;
+	rc = filter_build(ctx);
+	if (rc < 0)
+		goto out;
+	seccomp_release(ctx);
+	ctx = NULL;
+	if (cnt_src.allocs == 0 ||
+	    cnt_proc.allocs != cnt_proc.frees ||
+	    cnt_ctx.allocs != cnt_ctx.frees ||
+	    cnt_src.allocs != cnt_src.frees) {
+		rc = -EFAULT;
+		goto out;
+	}
+
+	/* restore the C library allocator */
+	rc = seccomp_set_allocator(NULL, NULL);
+	if (rc < 0)
+		goto out;
+	cnt_proc.allocs = 0;
+	ctx = seccomp_init(SCMP_ACT_ALLOW);
+	if (ctx == NULL) {
+		rc = -ENOMEM;
+		goto out;
+	}
+	rc = filter_build(ctx);
+	if (rc < 0)
+		goto out;
+	if (cnt_proc.allocs != 0)
+		rc = -EFAULT;
+
+out:
+	seccomp_release(ctx_src);
+	seccomp_release(ctx);
+	return (rc < 0 ? -rc : rc);
+}
@@ -0,0 +1,12 @@
+#!/bin/bash
+
+#
+# libseccomp regression test automation data
+#
+# Copyright (c) 2026 Microsoft Corporation <paulmoore@microsoft.com>
+# Author: Paul Moore <paul@paul-moore.com>
+#
+
+# NOTE: the custom allocators are only available through the C API, there is
+#       no python equivalent of this test
+./70-basic-allocator
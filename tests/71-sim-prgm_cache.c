@@ -0,0 +1,143 @@
+/**
+ * Seccomp Library test program
+ *
+ * Copyright (c) 2026 Microsoft Corporation <paulmoore@microsoft.com>
+ * Author: Paul Moore <paul@paul-moore.com>
+ */
+
+/*
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of version 2.1 of the GNU Lesser General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, see <http://www.gnu.org/licenses>.
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#include <seccomp.h>
+
+#include "util.h"
+
+static scmp_filter_ctx filter_build(bool reverse)
+{
+	int rc;
+	scmp_filter_ctx ctx;
+
+	ctx = seccomp_init(SCMP_ACT_KILL);
+	if (ctx == NULL)
+		return NULL;
+
+	rc = seccomp_arch_remove(ctx, SCMP_ARCH_NATIVE);
+	if (rc != 0)
+		goto err;
+	rc = seccomp_arch_add(ctx, SCMP_ARCH_X86_64);
+	if (rc != 0)
+		goto err;
+	rc = seccomp_attr_set(ctx, SCMP_FLTATR_CTL_CACHE, 1);
+	if (rc != 0)
+		goto err;
+	rc = seccomp_attr_set(ctx, SCMP_FLTATR_CTL_MINIMIZE, 1);
+	if (rc != 0)
+		goto err;
+
+	/* the same rules in a different order give the same fingerprint */
+	if (!reverse) {
+		rc = seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(read), 0);
+		if (rc != 0)
+			goto err;
+	}
+	rc = seccomp_rule_add(ctx, SCMP_ACT_ERRNO(2), SCMP_SYS(prctl), 1,
+			      SCMP_A0(SCMP_CMP_GE, 10));
+	if (rc != 0)
+		goto err;
+	rc = seccomp_rule_add(ctx, SCMP_ACT_ERRNO(2), SCMP_SYS(prctl), 1,
+			      SCMP_A0(SCMP_CMP_GE, 5));
+	if (rc != 0)
+		goto err;
+	rc = seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(write), 1,
+			      SCMP_A0(SCMP_CMP_EQ, 1));
+	if (rc != 0)
+		goto err;
+	if (reverse) {
+		rc = seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(read), 0);
+		if (rc != 0)
+			goto err;
+	}
+
+	return ctx;
+
+err:
+	seccomp_release(ctx);
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	int rc;
+	uint32_t val_a, val_b;
+	struct util_options opts;
+	scmp_filter_ctx ctx_a = NULL, ctx_b = NULL;
+
+	rc = util_getopt(argc, argv, &opts);
+	if (rc < 0)
+		goto out;
+
+	ctx_a = filter_build(false);
+	if (ctx_a == NULL) {
+		rc = ENOMEM;
+		goto out;
+	}
+	rc = seccomp_precompute(ctx_a);
+	if (rc != 0)
+		goto out;
+
+	/* the second filter shares the first filter's program */
+	ctx_b = filter_build(true);
+	if (ctx_b == NULL) {
+		rc = ENOMEM;
+		goto out;
+	}
+	rc = seccomp_precompute(ctx_b);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_attr_get(ctx_a, SCMP_FLTATR_STAT_MIN_NODES, &val_a);
+	if (rc != 0)
+		goto out;
+	rc = seccomp_attr_get(ctx_b, SCMP_FLTATR_STAT_MIN_NODES, &val_b);
+	if (rc != 0)
+		goto out;
+	if (val_a == 0 || val_a != val_b) {
+		rc = -1;
+		goto out;
+	}
+
+	/* the shared program must outlive the first filter */
+	seccomp_release(ctx_a);
+	ctx_a = NULL;
+	rc = seccomp_precompute(ctx_b);
+	if (rc != 0)
+		goto out;
+
+	/* changing the filter drops the shared program */
+	rc = seccomp_rule_add(ctx_b, SCMP_ACT_ERRNO(3), SCMP_SYS(close), 0);
+	if (rc != 0)
+		goto out;
+
+	rc = util_filter_output(&opts, ctx_b);
+	if (rc)
+		goto out;
+
+out:
+	seccomp_release(ctx_a);
+	seccomp_release(ctx_b);
+	return (rc < 0 ? -rc : rc);
+}
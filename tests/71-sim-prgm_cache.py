@@ -0,0 +1,61 @@
+#!/usr/bin/env python
+
+#
+# Seccomp Library test program
+#
+# Copyright (c) 2026 Microsoft Corporation <paulmoore@microsoft.com>
+# Author: Paul Moore <paul@paul-moore.com>
+#
+
+#
+# This library is free software; you can redistribute it and/or modify it
+# under the terms of version 2.1 of the GNU Lesser General Public License as
+# published by the Free Software Foundation.
+#
+# This library is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+# for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library; if not, see <http://www.gnu.org/licenses>.
+#
+
+import argparse
+import sys
+
+import util
+
+from seccomp import *
+
+def filter_build(reverse):
+    f = SyscallFilter(KILL)
+    f.remove_arch(Arch())
+    f.add_arch(Arch("x86_64"))
+    f.set_attr(Attr.CTL_CACHE, 1)
+    f.set_attr(Attr.CTL_MINIMIZE, 1)
+    if not reverse:
+        f.add_rule(ALLOW, "read")
+    f.add_rule(ERRNO(2), "prctl", Arg(0, GE, 10))
+    f.add_rule(ERRNO(2), "prctl", Arg(0, GE, 5))
+    f.add_rule(ALLOW, "write", Arg(0, EQ, 1))
+    if reverse:
+        f.add_rule(ALLOW, "read")
+    return f
+
+def test(args):
+    f_a = filter_build(False)
+    f_a.precompute()
+    f_b = filter_build(True)
+    f_b.precompute()
+    nodes = f_a.get_attr(Attr.STAT_MIN_NODES)
+    if nodes == 0 or f_b.get_attr(Attr.STAT_MIN_NODES) != nodes:
+        raise RuntimeError("Failed sharing the generated filter")
+    del f_a
+    f_b.precompute()
+    f_b.add_rule(ERRNO(3), "close")
+    return f_b
+
+args = util.get_opt()
+ctx = test(args)
+util.filter_output(args, ctx)
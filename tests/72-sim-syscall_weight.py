@@ -0,0 +1,57 @@
+#!/usr/bin/env python
+
+#
+# Seccomp Library test program
+#
+# Copyright (c) 2026 Microsoft Corporation <paulmoore@microsoft.com>
+# Author: Paul Moore <paul@paul-moore.com>
+#
+
+#
+# This library is free software; you can redistribute it and/or modify it
+# under the terms of version 2.1 of the GNU Lesser General Public License as
+# published by the Free Software Foundation.
+#
+# This library is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+# for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library; if not, see <http://www.gnu.org/licenses>.
+#
+
+import argparse
+import sys
+
+import util
+
+from seccomp import *
+
+def test(args):
+    f = SyscallFilter(KILL)
+    f.remove_arch(Arch())
+    f.add_arch(Arch("x86_64"))
+    f.set_attr(Attr.CTL_OPTIMIZE, 3)
+    f.syscall_weight("read", 200)
+    f.syscall_weight("getpid", 5000)
+    f.add_rule(ALLOW, "read")
+    f.add_rule(ALLOW, "write", Arg(0, EQ, 1))
+    f.add_rule(ERRNO(3), "close")
+    f.add_rule(ERRNO(2), "prctl", Arg(0, GE, 5), Arg(1, EQ, 0))
+    f.syscall_weight("write", 10)
+    f.syscall_weight("close", 1000)
+    f.syscall_weight("prctl", 50)
+    f.precompute()
+    cost_before = f.get_attr(Attr.STAT_COST_BEFORE)
+    cost_after = f.get_attr(Attr.STAT_COST_AFTER)
+    if cost_after == 0 or cost_after >= cost_before:
+        raise RuntimeError("Failed reducing the expected filter cost")
+    return f
+
+args = util.get_opt()
+ctx = test(args)
+util.filter_output(args, ctx)
+
+# kate: syntax python;
+# kate: indent-mode python; space-indent on; indent-width 4; mixedindent off;